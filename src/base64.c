@@ -68,11 +68,93 @@ signed char mbedtls_ct_base64_dec_value(unsigned char c, int url) {
   return val - 1;
 }
 
+/* encodes n bytes, a multiple of 3, to 4 characters per 3 byte group */
+static void base64_encode_c(unsigned char *dst, const unsigned char *src,
+                            size_t n, int url) {
+  
+  int C1, C2, C3;
+  
+  for (; n >= 3; n -= 3) {
+    C1 = *src++;
+    C2 = *src++;
+    C3 = *src++;
+
+    *dst++ = mbedtls_ct_base64_enc_char((C1 >> 2) & 0x3F, url);
+    *dst++ = mbedtls_ct_base64_enc_char((((C1 &  3) << 4) + (C2 >> 4))
+    & 0x3F, url);
+    *dst++ = mbedtls_ct_base64_enc_char((((C2 & 15) << 2) + (C3 >> 6))
+    & 0x3F, url);
+    *dst++ = mbedtls_ct_base64_enc_char(C3 & 0x3F, url);
+  }
+  
+}
+
+#if defined(SB_X86_SIMD)
+
+#include <immintrin.h>
+
+/*
+ *  Encodes 12 input bytes to 16 characters per iteration (W. Mula and D.
+ *  Lemire, "Faster Base64 Encoding and Decoding Using AVX2 Instructions").
+ *  Each 3 byte group is spread over a 32-bit lane and split into four 6-bit
+ *  indices by multiplies, which are mapped to characters by adding an offset
+ *  looked up with PSHUFB. No memory access depends on the data, so this is as
+ *  constant-time as the scalar encoder. As each load reads 16 bytes, the
+ *  final groups are left to the scalar encoder.
+ */
+__attribute__((target("ssse3")))
+static void base64_encode_ssse3(unsigned char *dst, const unsigned char *src,
+                                size_t n, int url) {
+  
+  const __m128i shuf = _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1);
+  const __m128i lut = _mm_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                    '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                    '0' - 52, (url ? '-' : '+') - 62, (url ? '_' : '/') - 63,
+                                    'A', 0, 0);
+  size_t i = 0;
+  
+  for (; i + 16 <= n; i += 12, dst += 16) {
+    __m128i in = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) (src + i)), shuf);
+    const __m128i t0 = _mm_mulhi_epu16(_mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00)),
+                                       _mm_set1_epi32(0x04000040));
+    const __m128i t1 = _mm_mullo_epi16(_mm_and_si128(in, _mm_set1_epi32(0x003f03f0)),
+                                       _mm_set1_epi32(0x01000010));
+    const __m128i idx = _mm_or_si128(t0, t1);
+    /* 0..25 -> 13, 26..51 -> 0, 52..61 -> 1..10, 62 -> 11, 63 -> 12 */
+    __m128i off = _mm_subs_epu8(idx, _mm_set1_epi8(51));
+    off = _mm_or_si128(off, _mm_and_si128(_mm_cmpgt_epi8(_mm_set1_epi8(26), idx),
+                                          _mm_set1_epi8(13)));
+    in = _mm_add_epi8(idx, _mm_shuffle_epi8(lut, off));
+    _mm_storeu_si128((__m128i *) dst, in);
+  }
+  
+  base64_encode_c(dst, src + i, n - i, url);
+  
+}
+
+#endif
+
+static void (*base64_encode_kernel)(unsigned char *, const unsigned char *, size_t,
+                                    int) = base64_encode_c;
+
+const char * sb_base64_select(const int cpu) {
+  
+#if defined(SB_X86_SIMD)
+  if (cpu & SB_CPU_SSSE3) {
+    base64_encode_kernel = base64_encode_ssse3;
+    return "ssse3";
+  }
+#endif
+  base64_encode_kernel = base64_encode_c;
+  return "portable";
+  
+}
+
 int mbedtls_base64_encode(unsigned char *dst, size_t dlen, size_t *olen,
                           const unsigned char *src, size_t slen, int url) {
   
   size_t i, n;
-  int C1, C2, C3;
+  int C1, C2;
   unsigned char *p;
   
   if (slen == 0) {
@@ -96,18 +178,10 @@ int mbedtls_base64_encode(unsigned char *dst, size_t dlen, size_t *olen,
   
   n = (slen / 3) * 3;
   
-  for (i = 0, p = dst; i < n; i += 3) {
-    C1 = *src++;
-    C2 = *src++;
-    C3 = *src++;
-
-    *p++ = mbedtls_ct_base64_enc_char((C1 >> 2) & 0x3F, url);
-    *p++ = mbedtls_ct_base64_enc_char((((C1 &  3) << 4) + (C2 >> 4))
-    & 0x3F, url);
-    *p++ = mbedtls_ct_base64_enc_char((((C2 & 15) << 2) + (C3 >> 6))
-    & 0x3F, url);
-    *p++ = mbedtls_ct_base64_enc_char(C3 & 0x3F, url);
-  }
+  base64_encode_kernel(dst, src, n, url);
+  src += n;
+  i = n;
+  p = dst + n / 3 * 4;
 
   if (i < slen) {
     C1 = *src++;
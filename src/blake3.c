@@ -0,0 +1,1150 @@
+// secretbase ------------------------------------------------------------------
+
+#include "secret.h"
+
+// secretbase - blake3 implementation ------------------------------------------
+
+/*
+ *  BLAKE3 implementation based on the official C implementation
+ *
+ *  Copyright 2019-2024 Jack O'Connor and Samuel Neves
+ *  SPDX-License-Identifier: CC0-1.0 OR Apache-2.0
+ */
+/*
+ *  BLAKE3 is specified in 'BLAKE3: one function, fast everywhere', Jack
+ *  O'Connor, Jean-Philippe Aumasson, Samuel Neves and Zooko Wilcox-O'Hearn.
+ *
+ *  https://github.com/BLAKE3-team/BLAKE3-specs/blob/master/blake3.pdf
+ */
+
+enum blake3_flags {
+  CHUNK_START         = 1 << 0,
+  CHUNK_END           = 1 << 1,
+  PARENT              = 1 << 2,
+  ROOT                = 1 << 3,
+  KEYED_HASH          = 1 << 4,
+  DERIVE_KEY_CONTEXT  = 1 << 5,
+  DERIVE_KEY_MATERIAL = 1 << 6
+};
+
+#define BLAKE3_MAX_SIMD_DEGREE 8
+
+/* subtrees of at least this size are split across worker threads, in parts of
+ * no less than the minimum part size (both powers of 2) */
+#define BLAKE3_PAR_MIN (1 << 20)
+#define BLAKE3_PAR_PART (1 << 18)
+
+/* file reads for threaded hashing: a power of 2, so that each read completes
+ * whole subtrees */
+#define BLAKE3_FILE_BUF (1 << 22)
+
+static const uint32_t BLAKE3_IV[8] = {
+  0x6A09E667UL, 0xBB67AE85UL, 0x3C6EF372UL, 0xA54FF53AUL,
+  0x510E527FUL, 0x9B05688CUL, 0x1F83D9ABUL, 0x5BE0CD19UL
+};
+
+static const uint8_t BLAKE3_MSG_SCHEDULE[7][16] = {
+  {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15},
+  {2, 6, 3, 10, 7, 0, 4, 13, 1, 11, 12, 5, 9, 14, 15, 8},
+  {3, 4, 10, 12, 13, 2, 7, 14, 6, 5, 9, 0, 11, 15, 8, 1},
+  {10, 7, 12, 9, 14, 3, 13, 15, 4, 0, 11, 2, 5, 8, 1, 6},
+  {12, 13, 9, 11, 15, 10, 14, 8, 7, 2, 5, 3, 0, 1, 6, 4},
+  {9, 14, 11, 5, 8, 12, 15, 1, 13, 3, 0, 10, 2, 6, 4, 7},
+  {11, 15, 5, 0, 1, 9, 8, 6, 14, 10, 2, 12, 3, 4, 7, 13}
+};
+
+typedef struct blake3_output {
+  uint32_t input_cv[8];
+  uint8_t block[BLAKE3_BLOCK_LEN];
+  uint8_t block_len;
+  uint64_t counter;
+  uint8_t flags;
+} blake3_output;
+
+static inline uint32_t load32(const void *src) {
+  const uint8_t *p = (const uint8_t *) src;
+  return ((uint32_t) p[0]) | ((uint32_t) p[1] << 8) |
+         ((uint32_t) p[2] << 16) | ((uint32_t) p[3] << 24);
+}
+
+static inline void store32(void *dst, uint32_t w) {
+  uint8_t *p = (uint8_t *) dst;
+  p[0] = (uint8_t) w;
+  p[1] = (uint8_t) (w >> 8);
+  p[2] = (uint8_t) (w >> 16);
+  p[3] = (uint8_t) (w >> 24);
+}
+
+static inline void load_key_words(const uint8_t key[BLAKE3_KEY_LEN], uint32_t key_words[8]) {
+  for (int i = 0; i < 8; i++)
+    key_words[i] = load32(&key[i * 4]);
+}
+
+static inline void store_cv_words(uint8_t out[BLAKE3_OUT_LEN], const uint32_t cv[8]) {
+  for (int i = 0; i < 8; i++)
+    store32(&out[i * 4], cv[i]);
+}
+
+static inline uint32_t rotr32(uint32_t w, uint32_t c) {
+  return (w >> c) | (w << (32 - c));
+}
+
+static inline size_t round_down_to_power_of_2(uint64_t x) {
+  uint64_t p = 1;
+  while (p <= x / 2)
+    p <<= 1;
+  return (size_t) p;
+}
+
+static inline unsigned int popcnt(uint64_t x) {
+  unsigned int count = 0;
+  for (; x; x &= x - 1)
+    count++;
+  return count;
+}
+
+// secretbase - blake3 portable compression -----------------------------------
+
+#define BLAKE3_G(s, a, b, c, d, x, y)                                         \
+  s[a] = s[a] + s[b] + (x);                                                   \
+  s[d] = rotr32(s[d] ^ s[a], 16);                                             \
+  s[c] = s[c] + s[d];                                                         \
+  s[b] = rotr32(s[b] ^ s[c], 12);                                             \
+  s[a] = s[a] + s[b] + (y);                                                   \
+  s[d] = rotr32(s[d] ^ s[a], 8);                                              \
+  s[c] = s[c] + s[d];                                                         \
+  s[b] = rotr32(s[b] ^ s[c], 7)
+
+static inline void blake3_round(uint32_t s[16], const uint32_t m[16], const size_t r) {
+  
+  const uint8_t *k = BLAKE3_MSG_SCHEDULE[r];
+  BLAKE3_G(s, 0, 4, 8, 12, m[k[0]], m[k[1]]);
+  BLAKE3_G(s, 1, 5, 9, 13, m[k[2]], m[k[3]]);
+  BLAKE3_G(s, 2, 6, 10, 14, m[k[4]], m[k[5]]);
+  BLAKE3_G(s, 3, 7, 11, 15, m[k[6]], m[k[7]]);
+  BLAKE3_G(s, 0, 5, 10, 15, m[k[8]], m[k[9]]);
+  BLAKE3_G(s, 1, 6, 11, 12, m[k[10]], m[k[11]]);
+  BLAKE3_G(s, 2, 7, 8, 13, m[k[12]], m[k[13]]);
+  BLAKE3_G(s, 3, 4, 9, 14, m[k[14]], m[k[15]]);
+  
+}
+
+static inline void blake3_compress_pre(uint32_t s[16], const uint32_t cv[8],
+                                       const uint8_t block[BLAKE3_BLOCK_LEN],
+                                       uint8_t block_len, uint64_t counter,
+                                       uint8_t flags) {
+  
+  uint32_t m[16];
+  for (int i = 0; i < 16; i++)
+    m[i] = load32(block + 4 * i);
+  
+  for (int i = 0; i < 8; i++)
+    s[i] = cv[i];
+  s[8] = BLAKE3_IV[0];
+  s[9] = BLAKE3_IV[1];
+  s[10] = BLAKE3_IV[2];
+  s[11] = BLAKE3_IV[3];
+  s[12] = (uint32_t) counter;
+  s[13] = (uint32_t) (counter >> 32);
+  s[14] = (uint32_t) block_len;
+  s[15] = (uint32_t) flags;
+  
+  for (size_t r = 0; r < 7; r++)
+    blake3_round(s, m, r);
+  
+}
+
+static void blake3_compress_in_place(uint32_t cv[8],
+                                     const uint8_t block[BLAKE3_BLOCK_LEN],
+                                     uint8_t block_len, uint64_t counter,
+                                     uint8_t flags) {
+  
+  uint32_t s[16];
+  blake3_compress_pre(s, cv, block, block_len, counter, flags);
+  for (int i = 0; i < 8; i++)
+    cv[i] = s[i] ^ s[i + 8];
+  
+}
+
+static void blake3_compress_xof(const uint32_t cv[8],
+                                const uint8_t block[BLAKE3_BLOCK_LEN],
+                                uint8_t block_len, uint64_t counter,
+                                uint8_t flags, uint8_t out[64]) {
+  
+  uint32_t s[16];
+  blake3_compress_pre(s, cv, block, block_len, counter, flags);
+  for (int i = 0; i < 8; i++) {
+    store32(&out[i * 4], s[i] ^ s[i + 8]);
+    store32(&out[(i + 8) * 4], s[i + 8] ^ cv[i]);
+  }
+  
+}
+
+static inline void blake3_hash_one_portable(const uint8_t *input, size_t blocks,
+                                            const uint32_t key[8], uint64_t counter,
+                                            uint8_t flags, uint8_t flags_start,
+                                            uint8_t flags_end, uint8_t out[BLAKE3_OUT_LEN]) {
+  
+  uint32_t cv[8];
+  memcpy(cv, key, BLAKE3_KEY_LEN);
+  uint8_t block_flags = flags | flags_start;
+  while (blocks > 0) {
+    if (blocks == 1)
+      block_flags |= flags_end;
+    blake3_compress_in_place(cv, input, BLAKE3_BLOCK_LEN, counter, block_flags);
+    input += BLAKE3_BLOCK_LEN;
+    blocks -= 1;
+    block_flags = flags;
+  }
+  store_cv_words(out, cv);
+  
+}
+
+/* hashes each of a batch of inputs, all of the same number of whole blocks, to
+ * a chaining value: chunks with consecutive counters, or else parent nodes */
+static void blake3_hash_many_portable(const uint8_t *const *inputs, size_t num_inputs,
+                                      size_t blocks, const uint32_t key[8],
+                                      uint64_t counter, int increment_counter,
+                                      uint8_t flags, uint8_t flags_start,
+                                      uint8_t flags_end, uint8_t *out) {
+  
+  while (num_inputs > 0) {
+    blake3_hash_one_portable(inputs[0], blocks, key, counter, flags, flags_start,
+                             flags_end, out);
+    if (increment_counter)
+      counter += 1;
+    inputs += 1;
+    num_inputs -= 1;
+    out += BLAKE3_OUT_LEN;
+  }
+  
+}
+
+// secretbase - blake3 multi-way SIMD kernels ----------------------------------
+
+/*
+ *  Several chunks (or parent nodes) are compressed at once, one per vector
+ *  lane: 4 with SSE4.1, or 8 with AVX2. Message words are transposed into
+ *  lanes on load, and chaining values transposed back on store. The AVX-512VL
+ *  variant of the 8-way kernel differs only in its native 32-bit rotates.
+ */
+
+#define BLAKE3_VG(v, a, b, c, d, x, y)                                        \
+  v[a] = VADD(VADD(v[a], v[b]), x);                                           \
+  v[d] = VROT16(VXOR(v[d], v[a]));                                            \
+  v[c] = VADD(v[c], v[d]);                                                    \
+  v[b] = VROT12(VXOR(v[b], v[c]));                                            \
+  v[a] = VADD(VADD(v[a], v[b]), y);                                           \
+  v[d] = VROT8(VXOR(v[d], v[a]));                                             \
+  v[c] = VADD(v[c], v[d]);                                                    \
+  v[b] = VROT7(VXOR(v[b], v[c]))
+
+#define BLAKE3_VROUND(v, m, r) {                                              \
+  const uint8_t *k = BLAKE3_MSG_SCHEDULE[r];                                  \
+  BLAKE3_VG(v, 0, 4, 8, 12, m[k[0]], m[k[1]]);                                \
+  BLAKE3_VG(v, 1, 5, 9, 13, m[k[2]], m[k[3]]);                                \
+  BLAKE3_VG(v, 2, 6, 10, 14, m[k[4]], m[k[5]]);                               \
+  BLAKE3_VG(v, 3, 7, 11, 15, m[k[6]], m[k[7]]);                               \
+  BLAKE3_VG(v, 0, 5, 10, 15, m[k[8]], m[k[9]]);                               \
+  BLAKE3_VG(v, 1, 6, 11, 12, m[k[10]], m[k[11]]);                             \
+  BLAKE3_VG(v, 2, 7, 8, 13, m[k[12]], m[k[13]]);                              \
+  BLAKE3_VG(v, 3, 4, 9, 14, m[k[14]], m[k[15]]);                              \
+}
+
+#ifdef SB_X86_SIMD
+
+#include <immintrin.h>
+
+#define VADD(a, b) _mm_add_epi32((a), (b))
+#define VXOR(a, b) _mm_xor_si128((a), (b))
+#define VROT16(x) _mm_shuffle_epi8((x), _mm_set_epi8(13, 12, 15, 14, 9, 8, 11, 10, 5, 4, 7, 6, 1, 0, 3, 2))
+#define VROT12(x) _mm_or_si128(_mm_srli_epi32((x), 12), _mm_slli_epi32((x), 20))
+#define VROT8(x) _mm_shuffle_epi8((x), _mm_set_epi8(12, 15, 14, 13, 8, 11, 10, 9, 4, 7, 6, 5, 0, 3, 2, 1))
+#define VROT7(x) _mm_or_si128(_mm_srli_epi32((x), 7), _mm_slli_epi32((x), 25))
+
+__attribute__((target("sse4.1")))
+static inline void blake3_transpose4(__m128i v[4]) {
+  
+  const __m128i ab01 = _mm_unpacklo_epi32(v[0], v[1]);
+  const __m128i ab23 = _mm_unpackhi_epi32(v[0], v[1]);
+  const __m128i cd01 = _mm_unpacklo_epi32(v[2], v[3]);
+  const __m128i cd23 = _mm_unpackhi_epi32(v[2], v[3]);
+  v[0] = _mm_unpacklo_epi64(ab01, cd01);
+  v[1] = _mm_unpackhi_epi64(ab01, cd01);
+  v[2] = _mm_unpacklo_epi64(ab23, cd23);
+  v[3] = _mm_unpackhi_epi64(ab23, cd23);
+  
+}
+
+__attribute__((target("sse4.1")))
+static void blake3_hash4_sse41(const uint8_t *const *inputs, size_t blocks,
+                               const uint32_t key[8], uint64_t counter,
+                               int increment_counter, uint8_t flags,
+                               uint8_t flags_start, uint8_t flags_end, uint8_t *out) {
+  
+  __m128i h[8], v[16], m[16];
+  uint32_t lo[4], hi[4];
+  for (int l = 0; l < 4; l++) {
+    const uint64_t c = counter + (increment_counter ? (uint64_t) l : 0);
+    lo[l] = (uint32_t) c;
+    hi[l] = (uint32_t) (c >> 32);
+  }
+  const __m128i counter_lo = _mm_loadu_si128((const __m128i *) lo);
+  const __m128i counter_hi = _mm_loadu_si128((const __m128i *) hi);
+  for (int i = 0; i < 8; i++)
+    h[i] = _mm_set1_epi32((int) key[i]);
+  
+  uint8_t block_flags = flags | flags_start;
+  for (size_t b = 0; b < blocks; b++) {
+    if (b + 1 == blocks)
+      block_flags |= flags_end;
+    for (int q = 0; q < 4; q++) {
+      for (int l = 0; l < 4; l++)
+        m[4 * q + l] = _mm_loadu_si128((const __m128i *) (inputs[l] + b * BLAKE3_BLOCK_LEN + 16 * q));
+      blake3_transpose4(m + 4 * q);
+    }
+    for (int i = 0; i < 8; i++)
+      v[i] = h[i];
+    v[8] = _mm_set1_epi32((int) BLAKE3_IV[0]);
+    v[9] = _mm_set1_epi32((int) BLAKE3_IV[1]);
+    v[10] = _mm_set1_epi32((int) BLAKE3_IV[2]);
+    v[11] = _mm_set1_epi32((int) BLAKE3_IV[3]);
+    v[12] = counter_lo;
+    v[13] = counter_hi;
+    v[14] = _mm_set1_epi32(BLAKE3_BLOCK_LEN);
+    v[15] = _mm_set1_epi32((int) block_flags);
+    for (size_t r = 0; r < 7; r++)
+      BLAKE3_VROUND(v, m, r);
+    for (int i = 0; i < 8; i++)
+      h[i] = VXOR(v[i], v[i + 8]);
+    block_flags = flags;
+  }
+  
+  blake3_transpose4(h);
+  blake3_transpose4(h + 4);
+  for (int l = 0; l < 4; l++) {
+    _mm_storeu_si128((__m128i *) (out + l * BLAKE3_OUT_LEN), h[l]);
+    _mm_storeu_si128((__m128i *) (out + l * BLAKE3_OUT_LEN + 16), h[l + 4]);
+  }
+  
+}
+
+#undef VADD
+#undef VXOR
+#undef VROT16
+#undef VROT12
+#undef VROT8
+#undef VROT7
+
+static void blake3_hash_many_sse41(const uint8_t *const *inputs, size_t num_inputs,
+                                   size_t blocks, const uint32_t key[8],
+                                   uint64_t counter, int increment_counter,
+                                   uint8_t flags, uint8_t flags_start,
+                                   uint8_t flags_end, uint8_t *out) {
+  
+  while (num_inputs >= 4) {
+    blake3_hash4_sse41(inputs, blocks, key, counter, increment_counter, flags,
+                       flags_start, flags_end, out);
+    if (increment_counter)
+      counter += 4;
+    inputs += 4;
+    num_inputs -= 4;
+    out += 4 * BLAKE3_OUT_LEN;
+  }
+  blake3_hash_many_portable(inputs, num_inputs, blocks, key, counter,
+                            increment_counter, flags, flags_start, flags_end, out);
+  
+}
+
+#endif
+
+#ifdef SB_X86_AVX2
+
+__attribute__((target("avx2")))
+static inline void blake3_transpose8(__m256i v[8]) {
+  
+  __m256i t[8];
+  for (int j = 0; j < 8; j += 2) {
+    t[j]     = _mm256_unpacklo_epi32(v[j], v[j + 1]);
+    t[j + 1] = _mm256_unpackhi_epi32(v[j], v[j + 1]);
+  }
+  for (int j = 0; j < 8; j += 4) {
+    v[j]     = _mm256_unpacklo_epi64(t[j], t[j + 2]);
+    v[j + 1] = _mm256_unpackhi_epi64(t[j], t[j + 2]);
+    v[j + 2] = _mm256_unpacklo_epi64(t[j + 1], t[j + 3]);
+    v[j + 3] = _mm256_unpackhi_epi64(t[j + 1], t[j + 3]);
+  }
+  for (int j = 0; j < 4; j++) {
+    t[j]     = _mm256_permute2x128_si256(v[j], v[j + 4], 0x20);
+    t[j + 4] = _mm256_permute2x128_si256(v[j], v[j + 4], 0x31);
+  }
+  for (int j = 0; j < 8; j++)
+    v[j] = t[j];
+  
+}
+
+/* defines an 8-way kernel from the primitives VADD, VXOR and VROT16-VROT7 */
+#define BLAKE3_HASH8(name)                                                    \
+static void name(const uint8_t *const *inputs, size_t blocks,                 \
+                 const uint32_t key[8], uint64_t counter,                     \
+                 int increment_counter, uint8_t flags,                        \
+                 uint8_t flags_start, uint8_t flags_end, uint8_t *out) {      \
+                                                                              \
+  __m256i h[8], v[16], m[16];                                                 \
+  uint32_t lo[8], hi[8];                                                      \
+  for (int l = 0; l < 8; l++) {                                               \
+    const uint64_t c = counter + (increment_counter ? (uint64_t) l : 0);      \
+    lo[l] = (uint32_t) c;                                                     \
+    hi[l] = (uint32_t) (c >> 32);                                             \
+  }                                                                           \
+  const __m256i counter_lo = _mm256_loadu_si256((const __m256i *) lo);        \
+  const __m256i counter_hi = _mm256_loadu_si256((const __m256i *) hi);        \
+  for (int i = 0; i < 8; i++)                                                 \
+    h[i] = _mm256_set1_epi32((int) key[i]);                                   \
+                                                                              \
+  uint8_t block_flags = flags | flags_start;                                  \
+  for (size_t b = 0; b < blocks; b++) {                                       \
+    if (b + 1 == blocks)                                                      \
+      block_flags |= flags_end;                                               \
+    for (int q = 0; q < 2; q++) {                                             \
+      for (int l = 0; l < 8; l++)                                             \
+        m[8 * q + l] = _mm256_loadu_si256((const __m256i *)                   \
+          (inputs[l] + b * BLAKE3_BLOCK_LEN + 32 * q));                       \
+      blake3_transpose8(m + 8 * q);                                           \
+    }                                                                         \
+    for (int i = 0; i < 8; i++)                                               \
+      v[i] = h[i];                                                            \
+    v[8] = _mm256_set1_epi32((int) BLAKE3_IV[0]);                             \
+    v[9] = _mm256_set1_epi32((int) BLAKE3_IV[1]);                             \
+    v[10] = _mm256_set1_epi32((int) BLAKE3_IV[2]);                            \
+    v[11] = _mm256_set1_epi32((int) BLAKE3_IV[3]);                            \
+    v[12] = counter_lo;                                                       \
+    v[13] = counter_hi;                                                       \
+    v[14] = _mm256_set1_epi32(BLAKE3_BLOCK_LEN);                              \
+    v[15] = _mm256_set1_epi32((int) block_flags);                             \
+    for (size_t r = 0; r < 7; r++)                                            \
+      BLAKE3_VROUND(v, m, r);                                                 \
+    for (int i = 0; i < 8; i++)                                               \
+      h[i] = VXOR(v[i], v[i + 8]);                                            \
+    block_flags = flags;                                                      \
+  }                                                                           \
+                                                                              \
+  blake3_transpose8(h);                                                       \
+  for (int l = 0; l < 8; l++)                                                 \
+    _mm256_storeu_si256((__m256i *) (out + l * BLAKE3_OUT_LEN), h[l]);        \
+                                                                              \
+}
+
+#define VADD(a, b) _mm256_add_epi32((a), (b))
+#define VXOR(a, b) _mm256_xor_si256((a), (b))
+#define VROT16(x) _mm256_shuffle_epi8((x), _mm256_set_epi8(13, 12, 15, 14, 9, 8, 11, 10, 5, 4, 7, 6, 1, 0, 3, 2, \
+                                                           13, 12, 15, 14, 9, 8, 11, 10, 5, 4, 7, 6, 1, 0, 3, 2))
+#define VROT12(x) _mm256_or_si256(_mm256_srli_epi32((x), 12), _mm256_slli_epi32((x), 20))
+#define VROT8(x) _mm256_shuffle_epi8((x), _mm256_set_epi8(12, 15, 14, 13, 8, 11, 10, 9, 4, 7, 6, 5, 0, 3, 2, 1, \
+                                                          12, 15, 14, 13, 8, 11, 10, 9, 4, 7, 6, 5, 0, 3, 2, 1))
+#define VROT7(x) _mm256_or_si256(_mm256_srli_epi32((x), 7), _mm256_slli_epi32((x), 25))
+
+__attribute__((target("avx2")))
+BLAKE3_HASH8(blake3_hash8_avx2)
+
+#undef VROT16
+#undef VROT12
+#undef VROT8
+#undef VROT7
+
+#define VROT16(x) _mm256_ror_epi32((x), 16)
+#define VROT12(x) _mm256_ror_epi32((x), 12)
+#define VROT8(x) _mm256_ror_epi32((x), 8)
+#define VROT7(x) _mm256_ror_epi32((x), 7)
+
+__attribute__((target("avx2,avx512f,avx512vl")))
+BLAKE3_HASH8(blake3_hash8_avx512)
+
+#undef VADD
+#undef VXOR
+#undef VROT16
+#undef VROT12
+#undef VROT8
+#undef VROT7
+
+static inline void blake3_hash_many_x8(const uint8_t *const *inputs, size_t num_inputs,
+                                       size_t blocks, const uint32_t key[8],
+                                       uint64_t counter, int increment_counter,
+                                       uint8_t flags, uint8_t flags_start,
+                                       uint8_t flags_end, uint8_t *out,
+                                       void (*hash8)(const uint8_t *const *, size_t,
+                                                     const uint32_t *, uint64_t, int,
+                                                     uint8_t, uint8_t, uint8_t, uint8_t *)) {
+  
+  while (num_inputs >= 8) {
+    hash8(inputs, blocks, key, counter, increment_counter, flags, flags_start,
+          flags_end, out);
+    if (increment_counter)
+      counter += 8;
+    inputs += 8;
+    num_inputs -= 8;
+    out += 8 * BLAKE3_OUT_LEN;
+  }
+  blake3_hash_many_sse41(inputs, num_inputs, blocks, key, counter,
+                         increment_counter, flags, flags_start, flags_end, out);
+  
+}
+
+static void blake3_hash_many_avx2(const uint8_t *const *inputs, size_t num_inputs,
+                                  size_t blocks, const uint32_t key[8],
+                                  uint64_t counter, int increment_counter,
+                                  uint8_t flags, uint8_t flags_start,
+                                  uint8_t flags_end, uint8_t *out) {
+  
+  blake3_hash_many_x8(inputs, num_inputs, blocks, key, counter, increment_counter,
+                      flags, flags_start, flags_end, out, blake3_hash8_avx2);
+  
+}
+
+static void blake3_hash_many_avx512(const uint8_t *const *inputs, size_t num_inputs,
+                                    size_t blocks, const uint32_t key[8],
+                                    uint64_t counter, int increment_counter,
+                                    uint8_t flags, uint8_t flags_start,
+                                    uint8_t flags_end, uint8_t *out) {
+  
+  blake3_hash_many_x8(inputs, num_inputs, blocks, key, counter, increment_counter,
+                      flags, flags_start, flags_end, out, blake3_hash8_avx512);
+  
+}
+
+#endif
+
+static void (*blake3_hash_many)(const uint8_t *const *, size_t, size_t,
+                                const uint32_t *, uint64_t, int, uint8_t,
+                                uint8_t, uint8_t, uint8_t *) = blake3_hash_many_portable;
+static size_t blake3_simd_degree = 1;
+
+const char * sb_blake3_select(const int cpu) {
+  
+#ifdef SB_X86_AVX2
+  if ((cpu & SB_CPU_AVX512) && (cpu & SB_CPU_SSE41)) {
+    blake3_hash_many = blake3_hash_many_avx512;
+    blake3_simd_degree = 8;
+    return "avx512";
+  }
+  if ((cpu & SB_CPU_AVX2) && (cpu & SB_CPU_SSE41)) {
+    blake3_hash_many = blake3_hash_many_avx2;
+    blake3_simd_degree = 8;
+    return "avx2";
+  }
+#endif
+#ifdef SB_X86_SIMD
+  if (cpu & SB_CPU_SSE41) {
+    blake3_hash_many = blake3_hash_many_sse41;
+    blake3_simd_degree = 4;
+    return "sse4.1";
+  }
+#endif
+  blake3_hash_many = blake3_hash_many_portable;
+  blake3_simd_degree = 1;
+  return "portable";
+  
+}
+
+// secretbase - blake3 chunk state and tree hashing ----------------------------
+
+static void blake3_chunk_state_init(blake3_chunk_state *self, const uint32_t key[8],
+                                    uint8_t flags) {
+  
+  memcpy(self->cv, key, BLAKE3_KEY_LEN);
+  self->chunk_counter = 0;
+  memset(self->buf, 0, BLAKE3_BLOCK_LEN);
+  self->buf_len = 0;
+  self->blocks_compressed = 0;
+  self->flags = flags;
+  
+}
+
+static void blake3_chunk_state_reset(blake3_chunk_state *self, const uint32_t key[8],
+                                     uint64_t chunk_counter) {
+  
+  memcpy(self->cv, key, BLAKE3_KEY_LEN);
+  self->chunk_counter = chunk_counter;
+  self->blocks_compressed = 0;
+  memset(self->buf, 0, BLAKE3_BLOCK_LEN);
+  self->buf_len = 0;
+  
+}
+
+static inline size_t blake3_chunk_state_len(const blake3_chunk_state *self) {
+  return (BLAKE3_BLOCK_LEN * (size_t) self->blocks_compressed) + ((size_t) self->buf_len);
+}
+
+static inline uint8_t blake3_chunk_state_start_flag(const blake3_chunk_state *self) {
+  return self->blocks_compressed == 0 ? CHUNK_START : 0;
+}
+
+static size_t blake3_chunk_state_fill_buf(blake3_chunk_state *self,
+                                          const uint8_t *input, size_t input_len) {
+  
+  size_t take = BLAKE3_BLOCK_LEN - ((size_t) self->buf_len);
+  if (take > input_len)
+    take = input_len;
+  memcpy(self->buf + self->buf_len, input, take);
+  self->buf_len += (uint8_t) take;
+  return take;
+  
+}
+
+static void blake3_chunk_state_update(blake3_chunk_state *self, const uint8_t *input,
+                                      size_t input_len) {
+  
+  if (self->buf_len > 0) {
+    size_t take = blake3_chunk_state_fill_buf(self, input, input_len);
+    input += take;
+    input_len -= take;
+    if (input_len > 0) {
+      blake3_compress_in_place(self->cv, self->buf, BLAKE3_BLOCK_LEN, self->chunk_counter,
+                               self->flags | blake3_chunk_state_start_flag(self));
+      self->blocks_compressed += 1;
+      self->buf_len = 0;
+      memset(self->buf, 0, BLAKE3_BLOCK_LEN);
+    }
+  }
+  
+  while (input_len > BLAKE3_BLOCK_LEN) {
+    blake3_compress_in_place(self->cv, input, BLAKE3_BLOCK_LEN, self->chunk_counter,
+                             self->flags | blake3_chunk_state_start_flag(self));
+    self->blocks_compressed += 1;
+    input += BLAKE3_BLOCK_LEN;
+    input_len -= BLAKE3_BLOCK_LEN;
+  }
+  
+  blake3_chunk_state_fill_buf(self, input, input_len);
+  
+}
+
+static blake3_output blake3_make_output(const uint32_t input_cv[8],
+                                        const uint8_t block[BLAKE3_BLOCK_LEN],
+                                        uint8_t block_len, uint64_t counter,
+                                        uint8_t flags) {
+  
+  blake3_output ret;
+  memcpy(ret.input_cv, input_cv, 32);
+  memcpy(ret.block, block, BLAKE3_BLOCK_LEN);
+  ret.block_len = block_len;
+  ret.counter = counter;
+  ret.flags = flags;
+  return ret;
+  
+}
+
+static void blake3_output_chaining_value(const blake3_output *self, uint8_t cv[32]) {
+  
+  uint32_t cv_words[8];
+  memcpy(cv_words, self->input_cv, 32);
+  blake3_compress_in_place(cv_words, self->block, self->block_len, self->counter, self->flags);
+  store_cv_words(cv, cv_words);
+  
+}
+
+static void blake3_output_root_bytes(const blake3_output *self, uint8_t *out, size_t out_len) {
+  
+  uint64_t output_block_counter = 0;
+  uint8_t wide_buf[64];
+  while (out_len > 0) {
+    blake3_compress_xof(self->input_cv, self->block, self->block_len,
+                        output_block_counter, self->flags | ROOT, wide_buf);
+    const size_t take = out_len < 64 ? out_len : 64;
+    memcpy(out, wide_buf, take);
+    out += take;
+    out_len -= take;
+    output_block_counter += 1;
+  }
+  
+}
+
+static blake3_output blake3_chunk_state_output(const blake3_chunk_state *self) {
+  
+  const uint8_t block_flags = self->flags | blake3_chunk_state_start_flag(self) | CHUNK_END;
+  return blake3_make_output(self->cv, self->buf, self->buf_len, self->chunk_counter,
+                            block_flags);
+  
+}
+
+static blake3_output blake3_parent_output(const uint8_t block[BLAKE3_BLOCK_LEN],
+                                          const uint32_t key[8], uint8_t flags) {
+  
+  return blake3_make_output(key, block, BLAKE3_BLOCK_LEN, 0, flags | PARENT);
+  
+}
+
+/* the largest power-of-2 number of chunks that leaves at least 1 byte for the
+ * right subtree */
+static inline size_t blake3_left_len(size_t content_len) {
+  
+  const size_t full_chunks = (content_len - 1) / BLAKE3_CHUNK_LEN;
+  return round_down_to_power_of_2(full_chunks) * BLAKE3_CHUNK_LEN;
+  
+}
+
+static size_t blake3_compress_chunks_parallel(const uint8_t *input, size_t input_len,
+                                              const uint32_t key[8], uint64_t chunk_counter,
+                                              uint8_t flags, uint8_t *out) {
+  
+  const uint8_t *chunks_array[BLAKE3_MAX_SIMD_DEGREE];
+  size_t input_position = 0;
+  size_t chunks_array_len = 0;
+  while (input_len - input_position >= BLAKE3_CHUNK_LEN) {
+    chunks_array[chunks_array_len] = &input[input_position];
+    input_position += BLAKE3_CHUNK_LEN;
+    chunks_array_len += 1;
+  }
+  
+  blake3_hash_many(chunks_array, chunks_array_len, BLAKE3_CHUNK_LEN / BLAKE3_BLOCK_LEN,
+                   key, chunk_counter, 1, flags, CHUNK_START, CHUNK_END, out);
+  
+  if (input_len > input_position) {
+    const uint64_t counter = chunk_counter + (uint64_t) chunks_array_len;
+    blake3_chunk_state chunk_state;
+    blake3_chunk_state_init(&chunk_state, key, flags);
+    chunk_state.chunk_counter = counter;
+    blake3_chunk_state_update(&chunk_state, &input[input_position], input_len - input_position);
+    blake3_output output = blake3_chunk_state_output(&chunk_state);
+    blake3_output_chaining_value(&output, &out[chunks_array_len * BLAKE3_OUT_LEN]);
+    return chunks_array_len + 1;
+  }
+  
+  return chunks_array_len;
+  
+}
+
+static size_t blake3_compress_parents_parallel(const uint8_t *child_chaining_values,
+                                               size_t num_chaining_values,
+                                               const uint32_t key[8], uint8_t flags,
+                                               uint8_t *out) {
+  
+  const uint8_t *parents_array[BLAKE3_MAX_SIMD_DEGREE];
+  size_t parents_array_len = 0;
+  while (num_chaining_values - (2 * parents_array_len) >= 2) {
+    parents_array[parents_array_len] = &child_chaining_values[2 * parents_array_len * BLAKE3_OUT_LEN];
+    parents_array_len += 1;
+  }
+  
+  blake3_hash_many(parents_array, parents_array_len, 1, key, 0, 0, flags | PARENT, 0, 0, out);
+  
+  if (num_chaining_values > 2 * parents_array_len) {
+    memcpy(&out[parents_array_len * BLAKE3_OUT_LEN],
+           &child_chaining_values[2 * parents_array_len * BLAKE3_OUT_LEN], BLAKE3_OUT_LEN);
+    return parents_array_len + 1;
+  }
+  
+  return parents_array_len;
+  
+}
+
+/* hashes a subtree as far as SIMD width allows, returning up to 2x the SIMD
+ * degree (minimum 2) chaining values */
+static size_t blake3_compress_subtree_wide(const uint8_t *input, size_t input_len,
+                                           const uint32_t key[8], uint64_t chunk_counter,
+                                           uint8_t flags, uint8_t *out) {
+  
+  if (input_len <= blake3_simd_degree * BLAKE3_CHUNK_LEN)
+    return blake3_compress_chunks_parallel(input, input_len, key, chunk_counter, flags, out);
+  
+  const size_t left_input_len = blake3_left_len(input_len);
+  const size_t right_input_len = input_len - left_input_len;
+  const uint8_t *right_input = &input[left_input_len];
+  const uint64_t right_chunk_counter = chunk_counter + (uint64_t) (left_input_len / BLAKE3_CHUNK_LEN);
+  
+  uint8_t cv_array[2 * BLAKE3_MAX_SIMD_DEGREE * BLAKE3_OUT_LEN];
+  size_t degree = blake3_simd_degree;
+  if (left_input_len > BLAKE3_CHUNK_LEN && degree == 1)
+    degree = 2;
+  uint8_t *right_cvs = &cv_array[degree * BLAKE3_OUT_LEN];
+  
+  const size_t left_n = blake3_compress_subtree_wide(input, left_input_len, key,
+                                                     chunk_counter, flags, cv_array);
+  const size_t right_n = blake3_compress_subtree_wide(right_input, right_input_len, key,
+                                                      right_chunk_counter, flags, right_cvs);
+  
+  if (left_n == 1) {
+    memcpy(out, cv_array, 2 * BLAKE3_OUT_LEN);
+    return 2;
+  }
+  
+  return blake3_compress_parents_parallel(cv_array, left_n + right_n, key, flags, out);
+  
+}
+
+/* hashes a subtree of more than 1 chunk down to the 2 chaining values of its
+ * root node */
+static void blake3_compress_subtree_to_parent_node(const uint8_t *input, size_t input_len,
+                                                   const uint32_t key[8], uint64_t chunk_counter,
+                                                   uint8_t flags, uint8_t out[2 * BLAKE3_OUT_LEN]) {
+  
+  uint8_t cv_array[2 * BLAKE3_MAX_SIMD_DEGREE * BLAKE3_OUT_LEN];
+  size_t num_cvs = blake3_compress_subtree_wide(input, input_len, key, chunk_counter,
+                                                flags, cv_array);
+  
+  uint8_t out_array[BLAKE3_MAX_SIMD_DEGREE * BLAKE3_OUT_LEN];
+  while (num_cvs > 2) {
+    num_cvs = blake3_compress_parents_parallel(cv_array, num_cvs, key, flags, out_array);
+    memcpy(cv_array, out_array, num_cvs * BLAKE3_OUT_LEN);
+  }
+  memcpy(out, cv_array, 2 * BLAKE3_OUT_LEN);
+  
+}
+
+typedef struct blake3_par_task {
+  const uint8_t *input;
+  size_t part_len;
+  const uint32_t *key;
+  uint64_t chunk_counter;
+  uint8_t flags;
+  uint8_t *cvs;
+} blake3_par_task;
+
+static void blake3_par_part(void *arg, size_t i) {
+  
+  const blake3_par_task *task = (const blake3_par_task *) arg;
+  uint8_t cv_pair[2 * BLAKE3_OUT_LEN];
+  blake3_compress_subtree_to_parent_node(task->input + i * task->part_len, task->part_len,
+                                         task->key,
+                                         task->chunk_counter + i * (task->part_len / BLAKE3_CHUNK_LEN),
+                                         task->flags, cv_pair);
+  blake3_output output = blake3_parent_output(cv_pair, task->key, task->flags);
+  blake3_output_chaining_value(&output, task->cvs + i * BLAKE3_OUT_LEN);
+  
+}
+
+/* a complete subtree of 2^k chunks splits into equal complete subtrees, hashed
+ * on worker threads, whose chaining values are then merged pairwise */
+static void blake3_compress_subtree_threaded(const uint8_t *input, size_t input_len,
+                                             const uint32_t key[8], uint64_t chunk_counter,
+                                             uint8_t flags, uint8_t out[2 * BLAKE3_OUT_LEN]) {
+  
+  size_t parts = 1;
+  const size_t max_parts = 4 * (size_t) sb_threads();
+  while (parts < max_parts && input_len / (parts * 2) >= BLAKE3_PAR_PART)
+    parts *= 2;
+  
+  uint8_t *cvs = malloc(parts * BLAKE3_OUT_LEN);
+  if (parts < 2 || cvs == NULL) {
+    free(cvs);
+    blake3_compress_subtree_to_parent_node(input, input_len, key, chunk_counter, flags, out);
+    return;
+  }
+  
+  blake3_par_task task = {input, input_len / parts, key, chunk_counter, flags, cvs};
+  sb_parallel(blake3_par_part, &task, parts);
+  
+  while (parts > 2) {
+    for (size_t i = 0; i < parts; i += BLAKE3_MAX_SIMD_DEGREE * 2) {
+      const size_t n = parts - i < BLAKE3_MAX_SIMD_DEGREE * 2 ? parts - i : BLAKE3_MAX_SIMD_DEGREE * 2;
+      blake3_compress_parents_parallel(cvs + i * BLAKE3_OUT_LEN, n, key, flags,
+                                       cvs + (i / 2) * BLAKE3_OUT_LEN);
+    }
+    parts /= 2;
+  }
+  memcpy(out, cvs, 2 * BLAKE3_OUT_LEN);
+  free(cvs);
+  
+}
+
+// secretbase - blake3 hasher --------------------------------------------------
+
+static void blake3_hasher_init_base(blake3_hasher *self, const uint32_t key[8],
+                                    uint8_t flags) {
+  
+  memcpy(self->key, key, BLAKE3_KEY_LEN);
+  blake3_chunk_state_init(&self->chunk, key, flags);
+  self->cv_stack_len = 0;
+  
+}
+
+static void blake3_hasher_init(blake3_hasher *self) {
+  
+  blake3_hasher_init_base(self, BLAKE3_IV, 0);
+  
+}
+
+static void blake3_hasher_init_keyed(blake3_hasher *self, const uint8_t key[BLAKE3_KEY_LEN]) {
+  
+  uint32_t key_words[8];
+  load_key_words(key, key_words);
+  blake3_hasher_init_base(self, key_words, KEYED_HASH);
+  
+}
+
+static void blake3_hasher_update(blake3_hasher *self, const void *input, size_t input_len);
+static void blake3_hasher_finalize(const blake3_hasher *self, uint8_t *out, size_t out_len);
+
+static void blake3_hasher_init_derive_key(blake3_hasher *self, const char *context,
+                                          size_t context_len) {
+  
+  blake3_hasher context_hasher;
+  blake3_hasher_init_base(&context_hasher, BLAKE3_IV, DERIVE_KEY_CONTEXT);
+  blake3_hasher_update(&context_hasher, context, context_len);
+  uint8_t context_key[BLAKE3_KEY_LEN];
+  blake3_hasher_finalize(&context_hasher, context_key, BLAKE3_KEY_LEN);
+  uint32_t context_key_words[8];
+  load_key_words(context_key, context_key_words);
+  blake3_hasher_init_base(self, context_key_words, DERIVE_KEY_MATERIAL);
+  sb_clear_buffer(&context_hasher, sizeof(blake3_hasher));
+  sb_clear_buffer(context_key, BLAKE3_KEY_LEN);
+  
+}
+
+/* lazily merges the stack, down to one entry per set bit of the total number
+ * of chunks, so that the root is only merged on finalization */
+static void blake3_hasher_merge_cv_stack(blake3_hasher *self, uint64_t total_len) {
+  
+  const size_t post_merge_stack_len = (size_t) popcnt(total_len);
+  while (self->cv_stack_len > post_merge_stack_len) {
+    uint8_t *parent_node = &self->cv_stack[(self->cv_stack_len - 2) * BLAKE3_OUT_LEN];
+    blake3_output output = blake3_parent_output(parent_node, self->key, self->chunk.flags);
+    blake3_output_chaining_value(&output, parent_node);
+    self->cv_stack_len -= 1;
+  }
+  
+}
+
+static void blake3_hasher_push_cv(blake3_hasher *self, uint8_t new_cv[BLAKE3_OUT_LEN],
+                                  uint64_t chunk_counter) {
+  
+  blake3_hasher_merge_cv_stack(self, chunk_counter);
+  memcpy(&self->cv_stack[self->cv_stack_len * BLAKE3_OUT_LEN], new_cv, BLAKE3_OUT_LEN);
+  self->cv_stack_len += 1;
+  
+}
+
+static void blake3_hasher_update(blake3_hasher *self, const void *input, size_t input_len) {
+  
+  if (input_len == 0)
+    return;
+  
+  const uint8_t *input_bytes = (const uint8_t *) input;
+  
+  if (blake3_chunk_state_len(&self->chunk) > 0) {
+    size_t take = BLAKE3_CHUNK_LEN - blake3_chunk_state_len(&self->chunk);
+    if (take > input_len)
+      take = input_len;
+    blake3_chunk_state_update(&self->chunk, input_bytes, take);
+    input_bytes += take;
+    input_len -= take;
+    if (input_len == 0)
+      return;
+    blake3_output output = blake3_chunk_state_output(&self->chunk);
+    uint8_t chunk_cv[32];
+    blake3_output_chaining_value(&output, chunk_cv);
+    blake3_hasher_push_cv(self, chunk_cv, self->chunk.chunk_counter);
+    blake3_chunk_state_reset(&self->chunk, self->key, self->chunk.chunk_counter + 1);
+  }
+  
+  /* hash the largest complete subtrees that the input and the alignment of the
+   * chunk counter allow, always keeping back the final chunk */
+  while (input_len > BLAKE3_CHUNK_LEN) {
+    size_t subtree_len = round_down_to_power_of_2(input_len);
+    const uint64_t count_so_far = self->chunk.chunk_counter * BLAKE3_CHUNK_LEN;
+    while ((((uint64_t) (subtree_len - 1)) & count_so_far) != 0)
+      subtree_len /= 2;
+    const uint64_t subtree_chunks = subtree_len / BLAKE3_CHUNK_LEN;
+    if (subtree_len <= BLAKE3_CHUNK_LEN) {
+      blake3_chunk_state chunk_state;
+      blake3_chunk_state_init(&chunk_state, self->key, self->chunk.flags);
+      chunk_state.chunk_counter = self->chunk.chunk_counter;
+      blake3_chunk_state_update(&chunk_state, input_bytes, subtree_len);
+      blake3_output output = blake3_chunk_state_output(&chunk_state);
+      uint8_t cv[BLAKE3_OUT_LEN];
+      blake3_output_chaining_value(&output, cv);
+      blake3_hasher_push_cv(self, cv, chunk_state.chunk_counter);
+    } else {
+      uint8_t cv_pair[2 * BLAKE3_OUT_LEN];
+      if (subtree_len >= BLAKE3_PAR_MIN && sb_threads() > 1) {
+        blake3_compress_subtree_threaded(input_bytes, subtree_len, self->key,
+                                         self->chunk.chunk_counter, self->chunk.flags, cv_pair);
+      } else {
+        blake3_compress_subtree_to_parent_node(input_bytes, subtree_len, self->key,
+                                               self->chunk.chunk_counter, self->chunk.flags, cv_pair);
+      }
+      blake3_hasher_push_cv(self, cv_pair, self->chunk.chunk_counter);
+      blake3_hasher_push_cv(self, &cv_pair[BLAKE3_OUT_LEN],
+                            self->chunk.chunk_counter + (subtree_chunks / 2));
+    }
+    self->chunk.chunk_counter += subtree_chunks;
+    input_bytes += subtree_len;
+    input_len -= subtree_len;
+  }
+  
+  if (input_len > 0) {
+    blake3_chunk_state_update(&self->chunk, input_bytes, input_len);
+    blake3_hasher_merge_cv_stack(self, self->chunk.chunk_counter);
+  }
+  
+}
+
+static void blake3_hasher_finalize(const blake3_hasher *self, uint8_t *out, size_t out_len) {
+  
+  if (out_len == 0)
+    return;
+  
+  if (self->cv_stack_len == 0) {
+    blake3_output output = blake3_chunk_state_output(&self->chunk);
+    blake3_output_root_bytes(&output, out, out_len);
+    return;
+  }
+  
+  /* roll up the stack into the root: from the partial chunk if there is one,
+   * otherwise from the top 2 entries, which are then both chunk hashes */
+  blake3_output output;
+  size_t cvs_remaining;
+  if (blake3_chunk_state_len(&self->chunk) > 0) {
+    cvs_remaining = self->cv_stack_len;
+    output = blake3_chunk_state_output(&self->chunk);
+  } else {
+    cvs_remaining = self->cv_stack_len - 2;
+    output = blake3_parent_output(&self->cv_stack[cvs_remaining * 32], self->key,
+                                  self->chunk.flags);
+  }
+  while (cvs_remaining > 0) {
+    cvs_remaining -= 1;
+    uint8_t parent_block[BLAKE3_BLOCK_LEN];
+    memcpy(parent_block, &self->cv_stack[cvs_remaining * 32], 32);
+    blake3_output_chaining_value(&output, &parent_block[32]);
+    output = blake3_parent_output(parent_block, self->key, self->chunk.flags);
+  }
+  blake3_output_root_bytes(&output, out, out_len);
+  
+}
+
+// secretbase - internals ------------------------------------------------------
+
+static void hash_bytes(void *ctx, const unsigned char *buf, size_t len) {
+  
+  blake3_hasher_update((blake3_hasher *) ctx, buf, len);
+  
+}
+
+static void hash_file(blake3_hasher *ctx, const SEXP x) {
+  
+  SB_ASSERT_STR(x);
+  const char *file = R_ExpandFileName(CHAR(*STRING_PTR_RO(x)));
+  const size_t bufsz = sb_threads() > 1 ? BLAKE3_FILE_BUF : SB_BUF_SIZE;
+  unsigned char *buf;
+  FILE *f;
+  size_t cur;
+  
+  if ((f = fopen(file, "rb")) == NULL)
+    ERROR_FOPEN(file);
+  
+  if ((buf = malloc(bufsz)) == NULL) {
+    fclose(f);
+    Rf_error("memory allocation failed");
+  }
+  
+  setbuf(f, NULL);
+  
+  while ((cur = fread(buf, sizeof(char), bufsz, f))) {
+    blake3_hasher_update(ctx, buf, cur);
+  }
+  
+  free(buf);
+  if (ferror(f)) {
+    fclose(f);
+    ERROR_FREAD(file);
+  }
+  fclose(f);
+  
+}
+
+static void hash_object(blake3_hasher *ctx, const SEXP x) {
+  
+  switch (TYPEOF(x)) {
+  case STRSXP:
+    if (XLENGTH(x) == 1 && NO_ATTRIB(x)) {
+      const char *s = CHAR(*STRING_PTR_RO(x));
+      blake3_hasher_update(ctx, (uint8_t *) s, strlen(s));
+      return;
+    }
+    break;
+  case RAWSXP:
+    if (NO_ATTRIB(x)) {
+      sb_hash_raw(x, ctx, hash_bytes);
+      return;
+    }
+    break;
+  }
+  
+  sb_hash_serial(x, ctx, hash_bytes);
+  
+}
+
+static void sb_blake3_init(blake3_hasher *ctx, const SEXP key, const SEXP context) {
+  
+  if (key != R_NilValue && context != R_NilValue)
+    Rf_error("'key' and 'context' cannot both be supplied");
+  
+  if (context != R_NilValue) {
+    if (TYPEOF(context) != STRSXP || XLENGTH(context) != 1)
+      Rf_error("'context' must be a character string");
+    const char *s = CHAR(*STRING_PTR_RO(context));
+    blake3_hasher_init_derive_key(ctx, s, strlen(s));
+    return;
+  }
+  
+  const unsigned char *data;
+  size_t klen;
+  switch (TYPEOF(key)) {
+  case NILSXP:
+    blake3_hasher_init(ctx);
+    return;
+  case STRSXP:
+    data = (const unsigned char *) (XLENGTH(key) ? CHAR(*STRING_PTR_RO(key)) : "");
+    klen = strlen((const char *) data);
+    break;
+  case RAWSXP:
+    data = (const unsigned char *) DATAPTR_RO(key);
+    klen = XLENGTH(key);
+    break;
+  default:
+    Rf_error("'key' must be a character string, raw vector or NULL");
+  }
+  if (klen != BLAKE3_KEY_LEN)
+    Rf_error("'key' must be exactly 32 bytes");
+  blake3_hasher_init_keyed(ctx, data);
+  
+}
+
+static SEXP secretbase_blake3_impl(const SEXP x, const SEXP bits, const SEXP key,
+                                   const SEXP context, const SEXP convert,
+                                   void (*const hash_func)(blake3_hasher *, SEXP)) {
+  
+  SB_ASSERT_LOGICAL(convert);
+  const int conv = SB_LOGICAL(convert);
+  const int bt = sb_integer(bits);
+  if (bt < 8 || bt > (1 << 24))
+    Rf_error("'bits' outside valid range of 8 to 2^24");
+  
+  const size_t sz = (size_t) (bt / 8);
+  unsigned char sbuf[SB_MAX_DIGEST];
+  unsigned char *buf = sz <= SB_MAX_DIGEST ? sbuf : (unsigned char *) R_alloc(sz, 1);
+  
+  blake3_hasher ctx;
+  sb_blake3_init(&ctx, key, context);
+  hash_func(&ctx, x);
+  blake3_hasher_finalize(&ctx, buf, sz);
+  sb_clear_buffer(&ctx, sizeof(blake3_hasher));
+  
+  return sb_hash_sexp(buf, sz, conv);
+  
+}
+
+// secretbase - exported functions ---------------------------------------------
+
+SEXP secretbase_blake3(SEXP x, SEXP bits, SEXP key, SEXP context, SEXP convert) {
+  
+  return secretbase_blake3_impl(x, bits, key, context, convert, hash_object);
+  
+}
+
+SEXP secretbase_blake3_file(SEXP x, SEXP bits, SEXP key, SEXP context, SEXP convert) {
+  
+  return secretbase_blake3_impl(x, bits, key, context, convert, hash_file);
+  
+}
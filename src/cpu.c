@@ -0,0 +1,149 @@
+// secretbase ------------------------------------------------------------------
+
+#include "secret.h"
+
+// secretbase - CPU feature detection and kernel dispatch -----------------------
+
+/*
+ *  CPU features are detected once, when the package is loaded. Each algorithm
+ *  with accelerated kernels registers a selection function, which sets the
+ *  algorithm's function pointers for a given feature mask and returns the name
+ *  of the kernel selected. Forcing the portable path re-runs every selection
+ *  with an empty mask.
+ */
+
+#if defined(SB_X86_SIMD)
+#include <cpuid.h>
+#endif
+
+#define SB_MAX_KERNELS 16
+
+typedef struct sb_kernel_slot {
+  const char *algo;
+  const char *(*select)(const int);
+  const char *active;
+} sb_kernel_slot;
+
+static sb_kernel_slot sb_kernels[SB_MAX_KERNELS];
+static int sb_nkernels = 0;
+static int sb_cpu_detected = 0;
+static int sb_cpu_portable = 0;
+
+static const struct {
+  int flag;
+  const char *name;
+} sb_cpu_names[] = {
+  {SB_CPU_SSSE3, "ssse3"},
+  {SB_CPU_SSE41, "sse4.1"},
+  {SB_CPU_AVX2, "avx2"},
+  {SB_CPU_AVX512, "avx512"},
+  {SB_CPU_SHANI, "sha-ni"},
+  {SB_CPU_BMI2, "bmi2"},
+  {SB_CPU_SSE42, "sse4.2"},
+  {SB_CPU_PCLMUL, "pclmul"}
+};
+
+static int sb_cpu_detect(void) {
+  
+  int cpu = 0;
+  
+#if defined(SB_X86_SIMD)
+  unsigned int eax, ebx, ecx, edx, xcr0 = 0;
+  
+  if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+    return 0;
+  
+  /* leaf 1 ECX: PCLMULQDQ (bit 1), SSSE3 (bit 9), SSE4.1 (bit 19), SSE4.2 (bit 20),
+   * OSXSAVE (bit 27), AVX (bit 28) */
+  if (ecx & (1u << 1)) cpu |= SB_CPU_PCLMUL;
+  if (ecx & (1u << 9)) cpu |= SB_CPU_SSSE3;
+  if (ecx & (1u << 19)) cpu |= SB_CPU_SSE41;
+  if (ecx & (1u << 20)) cpu |= SB_CPU_SSE42;
+  const int avx = (ecx & (1u << 28)) != 0;
+  
+  if (ecx & (1u << 27)) {
+    unsigned int hi;
+    __asm__ volatile ("xgetbv" : "=a" (xcr0), "=d" (hi) : "c" (0));
+  }
+  
+  if (__get_cpuid_max(0, NULL) >= 7) {
+    __cpuid_count(7, 0, eax, ebx, ecx, edx);
+    /* leaf 7 EBX: AVX2 (bit 5), BMI2 (bit 8), AVX-512F (bit 16), SHA (bit 29),
+     * AVX-512VL (bit 31); AVX state requires XCR0 bits 1-2, AVX-512 bits 5-7 */
+    if (avx && (xcr0 & 0x06) == 0x06 && (ebx & (1u << 5))) {
+      cpu |= SB_CPU_AVX2;
+      if ((xcr0 & 0xE6) == 0xE6 && (ebx & (1u << 16)) && (ebx & (1u << 31)))
+        cpu |= SB_CPU_AVX512;
+    }
+    if (ebx & (1u << 8)) cpu |= SB_CPU_BMI2;
+    if (ebx & (1u << 29)) cpu |= SB_CPU_SHANI;
+  }
+#endif
+  
+  return cpu;
+  
+}
+
+static inline int sb_cpu_features(void) {
+  return sb_cpu_portable ? 0 : sb_cpu_detected;
+}
+
+void sb_cpu_init(void) {
+  
+  const char *env = getenv("SECRETBASE_PORTABLE");
+  sb_cpu_detected = sb_cpu_detect();
+  sb_cpu_portable = env != NULL && (!strcmp(env, "1") || !strcmp(env, "T") ||
+                                    !strcmp(env, "TRUE") || !strcmp(env, "true") ||
+                                    !strcmp(env, "True"));
+  
+}
+
+void sb_kernel_register(const char *algo, const char *(*select)(const int)) {
+  
+  if (sb_nkernels == SB_MAX_KERNELS)
+    return;
+  sb_kernels[sb_nkernels].algo = algo;
+  sb_kernels[sb_nkernels].select = select;
+  sb_kernels[sb_nkernels].active = select(sb_cpu_features());
+  sb_nkernels++;
+  
+}
+
+// secretbase - exported functions ---------------------------------------------
+
+SEXP secretbase_kernels(SEXP portable) {
+  
+  if (portable != R_NilValue) {
+    if (TYPEOF(portable) != LGLSXP || XLENGTH(portable) != 1 || SB_LOGICAL(portable) == NA_LOGICAL)
+      Rf_error("'portable' must be TRUE or FALSE");
+    sb_cpu_portable = SB_LOGICAL(portable);
+    const int cpu = sb_cpu_features();
+    for (int i = 0; i < sb_nkernels; i++)
+      sb_kernels[i].active = sb_kernels[i].select(cpu);
+  }
+  
+  SEXP out, names, cpu;
+  const int ncpu = (int) (sizeof(sb_cpu_names) / sizeof(sb_cpu_names[0]));
+  int n = 0;
+  
+  PROTECT(out = Rf_allocVector(STRSXP, sb_nkernels));
+  names = Rf_allocVector(STRSXP, sb_nkernels);
+  Rf_namesgets(out, names);
+  for (int i = 0; i < sb_nkernels; i++) {
+    SET_STRING_ELT(out, i, Rf_mkChar(sb_kernels[i].active));
+    SET_STRING_ELT(names, i, Rf_mkChar(sb_kernels[i].algo));
+  }
+  
+  for (int i = 0; i < ncpu; i++)
+    n += (sb_cpu_detected & sb_cpu_names[i].flag) != 0;
+  cpu = Rf_allocVector(STRSXP, n);
+  Rf_setAttrib(out, Rf_install("cpu"), cpu);
+  for (int i = 0, j = 0; i < ncpu; i++) {
+    if (sb_cpu_detected & sb_cpu_names[i].flag)
+      SET_STRING_ELT(cpu, j++, Rf_mkChar(sb_cpu_names[i].name));
+  }
+  
+  UNPROTECT(1);
+  return out;
+  
+}
@@ -0,0 +1,248 @@
+// secretbase ------------------------------------------------------------------
+
+#include "secret.h"
+
+// secretbase - crc32c implementation ------------------------------------------
+
+/*
+ *  CRC-32C (Castagnoli) cyclic redundancy check, using the reflected
+ *  polynomial 0x82F63B78 as specified in RFC 3720 section 12.1, with the
+ *  register initialised to and finally XORed with all ones.
+ *
+ *  The portable kernel is table-driven, consuming 8 bytes per step (slicing
+ *  by 8). The SSE4.2 kernel uses the crc32 instruction on 8 bytes at a time.
+ *  Where PCLMULQDQ is also available, large inputs are split into 3 streams
+ *  hashed in an interleaved fashion, hiding the latency of the crc32
+ *  instruction, which are then recombined by carry-less multiplication.
+ */
+
+#define CRC32C_POLY 0x82F63B78U
+#define CRC32C_LONG 8192
+#define CRC32C_SHORT 256
+
+static uint32_t crc32c_table[8][256];
+
+static void crc32c_table_init(void) {
+  
+  if (crc32c_table[0][1])
+    return;
+  
+  for (uint32_t i = 0; i < 256; i++) {
+    uint32_t c = i;
+    for (int k = 0; k < 8; k++)
+      c = c & 1 ? (c >> 1) ^ CRC32C_POLY : c >> 1;
+    crc32c_table[0][i] = c;
+  }
+  for (int t = 1; t < 8; t++) {
+    for (int i = 0; i < 256; i++) {
+      const uint32_t c = crc32c_table[t - 1][i];
+      crc32c_table[t][i] = (c >> 8) ^ crc32c_table[0][c & 0xFF];
+    }
+  }
+  
+}
+
+static uint32_t crc32c_portable(uint32_t crc, const uint8_t *p, size_t n) {
+  
+  while (n >= 8) {
+    const uint32_t lo = crc ^ ((uint32_t) p[0] | (uint32_t) p[1] << 8 |
+                               (uint32_t) p[2] << 16 | (uint32_t) p[3] << 24);
+    const uint32_t hi = (uint32_t) p[4] | (uint32_t) p[5] << 8 |
+                        (uint32_t) p[6] << 16 | (uint32_t) p[7] << 24;
+    crc = crc32c_table[7][lo & 0xFF] ^ crc32c_table[6][(lo >> 8) & 0xFF] ^
+          crc32c_table[5][(lo >> 16) & 0xFF] ^ crc32c_table[4][lo >> 24] ^
+          crc32c_table[3][hi & 0xFF] ^ crc32c_table[2][(hi >> 8) & 0xFF] ^
+          crc32c_table[1][(hi >> 16) & 0xFF] ^ crc32c_table[0][hi >> 24];
+    p += 8;
+    n -= 8;
+  }
+  while (n--)
+    crc = (crc >> 8) ^ crc32c_table[0][(crc ^ *p++) & 0xFF];
+  
+  return crc;
+  
+}
+
+#if defined(SB_X86_SIMD) && defined(__x86_64__)
+
+#include <immintrin.h>
+
+__attribute__((target("sse4.2")))
+static uint32_t crc32c_sse42(uint32_t crc, const uint8_t *p, size_t n) {
+  
+  uint64_t c = crc;
+  while (n >= 8) {
+    c = _mm_crc32_u64(c, mbedtls_get_unaligned_uint64(p));
+    p += 8;
+    n -= 8;
+  }
+  crc = (uint32_t) c;
+  while (n--)
+    crc = _mm_crc32_u8(crc, *p++);
+  
+  return crc;
+  
+}
+
+/*
+ *  Shifting a CRC over n zero bytes is multiplication by x^(8n) modulo the
+ *  polynomial. Carry-less multiplying by the bit-reflected constant
+ *  x^(8n - 33) mod P, then reducing the 64-bit product with the crc32
+ *  instruction, applies this shift in a single step. Constants are for n of
+ *  CRC32C_LONG, 2 * CRC32C_LONG, CRC32C_SHORT and 2 * CRC32C_SHORT.
+ */
+static const uint64_t crc32c_k[4] = {
+  0x54A86326, 0x1DC403CC, 0xB9E02B86, 0xDD7E3B0C
+};
+
+__attribute__((target("sse4.2,pclmul")))
+static inline uint32_t crc32c_combine3(const uint32_t c0, const uint32_t c1,
+                                       const uint32_t c2, const uint64_t *k) {
+  
+  const __m128i a = _mm_clmulepi64_si128(_mm_cvtsi32_si128((int) c0),
+                                         _mm_cvtsi64_si128((long long) k[1]), 0x00);
+  const __m128i b = _mm_clmulepi64_si128(_mm_cvtsi32_si128((int) c1),
+                                         _mm_cvtsi64_si128((long long) k[0]), 0x00);
+  
+  return (uint32_t) _mm_crc32_u64(0, (uint64_t) _mm_cvtsi128_si64(_mm_xor_si128(a, b))) ^ c2;
+  
+}
+
+#define CRC32C_3WAY(len, k)                                                   \
+while (n >= 3 * (len)) {                                                      \
+  uint64_t c0 = crc, c1 = 0, c2 = 0;                                          \
+  for (size_t i = 0; i < (len); i += 8) {                                     \
+    c0 = _mm_crc32_u64(c0, mbedtls_get_unaligned_uint64(p + i));              \
+    c1 = _mm_crc32_u64(c1, mbedtls_get_unaligned_uint64(p + (len) + i));      \
+    c2 = _mm_crc32_u64(c2, mbedtls_get_unaligned_uint64(p + 2 * (len) + i));  \
+  }                                                                           \
+  crc = crc32c_combine3((uint32_t) c0, (uint32_t) c1, (uint32_t) c2, k);      \
+  p += 3 * (len);                                                             \
+  n -= 3 * (len);                                                             \
+}
+
+__attribute__((target("sse4.2,pclmul")))
+static uint32_t crc32c_pclmul(uint32_t crc, const uint8_t *p, size_t n) {
+  
+  CRC32C_3WAY(CRC32C_LONG, crc32c_k);
+  CRC32C_3WAY(CRC32C_SHORT, crc32c_k + 2);
+  
+  return crc32c_sse42(crc, p, n);
+  
+}
+
+#undef CRC32C_3WAY
+
+#endif
+
+static uint32_t (*crc32c_kernel)(uint32_t, const uint8_t *, size_t) = crc32c_portable;
+
+const char * sb_crc32c_select(const int cpu) {
+  
+  crc32c_table_init();
+  
+#if defined(SB_X86_SIMD) && defined(__x86_64__)
+  if ((cpu & SB_CPU_SSE42) && (cpu & SB_CPU_PCLMUL)) {
+    crc32c_kernel = crc32c_pclmul;
+    return "pclmul";
+  }
+  if (cpu & SB_CPU_SSE42) {
+    crc32c_kernel = crc32c_sse42;
+    return "sse4.2";
+  }
+#endif
+  crc32c_kernel = crc32c_portable;
+  return "portable";
+  
+}
+
+static inline void crc32c_update(uint32_t *crc, const uint8_t *p, const size_t n) {
+  
+  *crc = crc32c_kernel(*crc, p, n);
+  
+}
+
+// secretbase - internals ------------------------------------------------------
+
+static void hash_bytes(void *ctx, const unsigned char *buf, size_t len) {
+  
+  crc32c_update((uint32_t *) ctx, buf, len);
+  
+}
+
+static void hash_file(uint32_t *ctx, const SEXP x) {
+  
+  SB_ASSERT_STR(x);
+  const char *file = R_ExpandFileName(CHAR(*STRING_PTR_RO(x)));
+  unsigned char buf[SB_BUF_SIZE];
+  FILE *f;
+  size_t cur;
+  
+  if ((f = fopen(file, "rb")) == NULL)
+    ERROR_FOPEN(file);
+  
+  setbuf(f, NULL);
+  
+  while ((cur = fread(buf, sizeof(char), SB_BUF_SIZE, f))) {
+    crc32c_update(ctx, buf, cur);
+  }
+  
+  if (ferror(f)) {
+    fclose(f);
+    ERROR_FREAD(file);
+  }
+  fclose(f);
+  
+}
+
+static void hash_object(uint32_t *ctx, const SEXP x) {
+  
+  switch (TYPEOF(x)) {
+  case STRSXP:
+    if (XLENGTH(x) == 1 && NO_ATTRIB(x)) {
+      const char *s = CHAR(*STRING_PTR_RO(x));
+      crc32c_update(ctx, (uint8_t *) s, strlen(s));
+      return;
+    }
+    break;
+  case RAWSXP:
+    if (NO_ATTRIB(x)) {
+      sb_hash_raw(x, ctx, hash_bytes);
+      return;
+    }
+    break;
+  }
+  
+  sb_hash_serial(x, ctx, hash_bytes);
+  
+}
+
+static SEXP secretbase_crc32c_impl(const SEXP x, const SEXP convert,
+                                   void (*const hash_func)(uint32_t *, SEXP)) {
+  
+  SB_ASSERT_LOGICAL(convert);
+  const int conv = SB_LOGICAL(convert);
+  unsigned char buf[SB_CRC32C_SIZE];
+  
+  uint32_t crc = 0xFFFFFFFF;
+  hash_func(&crc, x);
+  crc ^= 0xFFFFFFFF;
+  MBEDTLS_PUT_UINT32_BE(crc, buf, 0);
+  
+  return sb_hash_sexp(buf, SB_CRC32C_SIZE, conv);
+  
+}
+
+// secretbase - exported functions ---------------------------------------------
+
+SEXP secretbase_crc32c(SEXP x, SEXP convert) {
+  
+  return secretbase_crc32c_impl(x, convert, hash_object);
+  
+}
+
+SEXP secretbase_crc32c_file(SEXP x, SEXP convert) {
+  
+  return secretbase_crc32c_impl(x, convert, hash_file);
+  
+}
@@ -0,0 +1,275 @@
+// secretbase ------------------------------------------------------------------
+
+#include "secret.h"
+
+// secretbase - incremental hashing contexts -----------------------------------
+
+/*
+ *  A hashing context wraps the running state of one of the streaming hash
+ *  algorithms in an external pointer, so that input may be supplied in any
+ *  number of pieces. Each algorithm provides its state size and init, update
+ *  and digest functions through an sb_hash_ops table. Digests are computed on
+ *  a copy of the state, leaving the context free to absorb further input.
+ *
+ *  The state may be exported to a raw vector and restored later, for example
+ *  to extend the hash of an append-only file with just the bytes added since.
+ *  The exported state is a fixed header (magic, algorithm, digest size, bytes
+ *  absorbed and name) followed by the algorithm context in native layout, so
+ *  it is specific to the platform.
+ */
+
+#define SB_HASH_MAGIC "SBH\001"
+#define SB_HASH_NAME 16
+#define SB_HASH_HEADER (16 + SB_HASH_NAME)
+
+typedef struct sb_hasher {
+  const sb_hash_ops *ops;
+  size_t size;
+  uint64_t bytes;
+  char name[SB_HASH_NAME];
+  uint64_t ctx[];
+} sb_hasher;
+
+static const struct {
+  const char *algo;
+  const sb_hash_ops *ops;
+} sb_hash_algos[] = {
+  {"sha256", &sb_sha256_ops},
+  {"sha3", &sb_sha3_ops},
+  {"siphash13", &sb_siphash13_ops}
+};
+
+#define SB_HASH_NALGOS (int) (sizeof(sb_hash_algos) / sizeof(sb_hash_algos[0]))
+
+static void hasher_finalizer(SEXP xptr) {
+  
+  sb_hasher *h = (sb_hasher *) R_ExternalPtrAddr(xptr);
+  if (h == NULL) return;
+  sb_clear_buffer(h, sizeof(sb_hasher) + h->ops->size);
+  free(h);
+  R_ClearExternalPtr(xptr);
+  
+}
+
+static sb_hasher * sb_hasher_ptr(const SEXP x) {
+  
+  if (TYPEOF(x) != EXTPTRSXP || !Rf_inherits(x, "secretbase_hash"))
+    Rf_error("'ctx' is not a valid hashing context");
+  sb_hasher *h = (sb_hasher *) R_ExternalPtrAddr(x);
+  if (h == NULL)
+    Rf_error("'ctx' is not a valid hashing context");
+  
+  return h;
+  
+}
+
+/* wraps a newly allocated context, freed by the finalizer */
+static SEXP sb_hasher_xptr(sb_hasher **h, const sb_hash_ops *ops) {
+  
+  if ((*h = calloc(1, sizeof(sb_hasher) + ops->size)) == NULL)
+    Rf_error("memory allocation failed");
+  (*h)->ops = ops;
+  
+  SEXP xptr, klass;
+  PROTECT(xptr = R_MakeExternalPtr(*h, R_NilValue, R_NilValue));
+  R_RegisterCFinalizerEx(xptr, hasher_finalizer, TRUE);
+  klass = Rf_mkString("secretbase_hash");
+  Rf_classgets(xptr, klass);
+  
+  UNPROTECT(1);
+  return xptr;
+  
+}
+
+static inline void hasher_update(sb_hasher *h, const unsigned char *buf, const size_t len) {
+  
+  h->ops->update(h->ctx, buf, len);
+  h->bytes += len;
+  
+}
+
+static void hash_bytes(void *ctx, const unsigned char *buf, size_t len) {
+  
+  hasher_update((sb_hasher *) ctx, buf, len);
+  
+}
+
+static void hash_file(sb_hasher *h, const SEXP x, const int64_t offset) {
+  
+  SB_ASSERT_STR(x);
+  const char *file = R_ExpandFileName(CHAR(*STRING_PTR_RO(x)));
+  unsigned char buf[SB_BUF_SIZE];
+  FILE *f;
+  size_t cur;
+  
+  if ((f = fopen(file, "rb")) == NULL)
+    ERROR_FOPEN(file);
+  
+  if (offset && SB_FSEEK(f, offset, SEEK_SET)) {
+    fclose(f);
+    ERROR_FREAD(file);
+  }
+  
+  setbuf(f, NULL);
+  
+  while ((cur = fread(buf, sizeof(char), SB_BUF_SIZE, f))) {
+    hasher_update(h, buf, cur);
+  }
+  
+  if (ferror(f)) {
+    fclose(f);
+    ERROR_FREAD(file);
+  }
+  fclose(f);
+  
+}
+
+static void hash_object(sb_hasher *h, const SEXP x) {
+  
+  switch (TYPEOF(x)) {
+  case STRSXP:
+    if (XLENGTH(x) == 1 && NO_ATTRIB(x)) {
+      const char *s = CHAR(*STRING_PTR_RO(x));
+      hasher_update(h, (unsigned char *) s, strlen(s));
+      return;
+    }
+    break;
+  case RAWSXP:
+    if (NO_ATTRIB(x)) {
+      sb_hash_raw(x, h, hash_bytes);
+      return;
+    }
+    break;
+  }
+  
+  sb_hash_serial(x, h, hash_bytes);
+  
+}
+
+static inline void sb_hasher_algorithm(const SEXP xptr, const sb_hasher *h) {
+  
+  Rf_setAttrib(xptr, Rf_install("algorithm"), Rf_mkString(h->name));
+  
+}
+
+// secretbase - exported functions ---------------------------------------------
+
+SEXP secretbase_hasher(SEXP algo, SEXP bits, SEXP key) {
+  
+  const char *a = TYPEOF(algo) == STRSXP && XLENGTH(algo) == 1 ? CHAR(*STRING_PTR_RO(algo)) : "";
+  int i = 0;
+  while (i < SB_HASH_NALGOS && strcmp(a, sb_hash_algos[i].algo))
+    i++;
+  if (i == SB_HASH_NALGOS)
+    Rf_error("'algo' must be one of 'sha256', 'sha3' or 'siphash13'");
+  
+  sb_hasher *h;
+  SEXP xptr;
+  PROTECT(xptr = sb_hasher_xptr(&h, sb_hash_algos[i].ops));
+  const char *name = h->ops->init(h->ctx, bits, key, &h->size);
+  strncpy(h->name, name, SB_HASH_NAME - 1);
+  sb_hasher_algorithm(xptr, h);
+  
+  UNPROTECT(1);
+  return xptr;
+  
+}
+
+SEXP secretbase_hasher_update(SEXP ctx, SEXP x) {
+  
+  hash_object(sb_hasher_ptr(ctx), x);
+  return ctx;
+  
+}
+
+SEXP secretbase_hasher_update_file(SEXP ctx, SEXP x, SEXP offset) {
+  
+  sb_hasher *h = sb_hasher_ptr(ctx);
+  const double off = Rf_asReal(offset);
+  if (!(off >= 0 && off <= 9007199254740992.0))
+    Rf_error("'offset' must be a non-negative number");
+  hash_file(h, x, (int64_t) off);
+  return ctx;
+  
+}
+
+SEXP secretbase_hasher_digest(SEXP ctx, SEXP convert) {
+  
+  SB_ASSERT_LOGICAL(convert);
+  const int conv = SB_LOGICAL(convert);
+  const sb_hasher *h = sb_hasher_ptr(ctx);
+  unsigned char buf[SB_MAX_DIGEST];
+  
+  h->ops->digest(h->ctx, buf);
+  SEXP out = sb_hash_sexp(buf, h->size, conv);
+  sb_clear_buffer(buf, SB_MAX_DIGEST);
+  
+  return out;
+  
+}
+
+SEXP secretbase_hasher_clone(SEXP ctx) {
+  
+  const sb_hasher *h = sb_hasher_ptr(ctx);
+  sb_hasher *c;
+  SEXP xptr;
+  PROTECT(xptr = sb_hasher_xptr(&c, h->ops));
+  memcpy(c, h, sizeof(sb_hasher) + h->ops->size);
+  sb_hasher_algorithm(xptr, c);
+  
+  UNPROTECT(1);
+  return xptr;
+  
+}
+
+SEXP secretbase_hasher_bytes(SEXP ctx) {
+  
+  return Rf_ScalarReal((double) sb_hasher_ptr(ctx)->bytes);
+  
+}
+
+SEXP secretbase_hasher_state(SEXP ctx) {
+  
+  const sb_hasher *h = sb_hasher_ptr(ctx);
+  int id = 0;
+  while (sb_hash_algos[id].ops != h->ops)
+    id++;
+  
+  SEXP out = Rf_allocVector(RAWSXP, SB_HASH_HEADER + h->ops->size);
+  unsigned char *p = (unsigned char *) DATAPTR(out);
+  memset(p, 0, SB_HASH_HEADER);
+  memcpy(p, SB_HASH_MAGIC, 4);
+  p[4] = (unsigned char) id;
+  p[5] = (unsigned char) h->size;
+  MBEDTLS_PUT_UINT64_LE(h->bytes, p, 8);
+  memcpy(p + 16, h->name, SB_HASH_NAME);
+  memcpy(p + SB_HASH_HEADER, h->ctx, h->ops->size);
+  
+  return out;
+  
+}
+
+SEXP secretbase_hasher_restore(SEXP state) {
+  
+  const unsigned char *p = TYPEOF(state) == RAWSXP ? (const unsigned char *) DATAPTR_RO(state) : NULL;
+  const int id = p != NULL && XLENGTH(state) >= SB_HASH_HEADER ? p[4] : SB_HASH_NALGOS;
+  if (id >= SB_HASH_NALGOS || memcmp(p, SB_HASH_MAGIC, 4) || p[5] == 0 || p[5] > SB_MAX_DIGEST ||
+      p[16 + SB_HASH_NAME - 1] != 0 ||
+      (size_t) XLENGTH(state) != SB_HASH_HEADER + sb_hash_algos[id].ops->size)
+    Rf_error("'state' is not a valid hashing state");
+  
+  sb_hasher *h;
+  SEXP xptr;
+  PROTECT(xptr = sb_hasher_xptr(&h, sb_hash_algos[id].ops));
+  h->size = p[5];
+  h->bytes = MBEDTLS_GET_UINT64_LE(p, 8);
+  memcpy(h->name, p + 16, SB_HASH_NAME);
+  memcpy(h->ctx, p + SB_HASH_HEADER, h->ops->size);
+  if (!h->ops->check(h->ctx, h->size))
+    Rf_error("'state' is not a valid hashing state");
+  sb_hasher_algorithm(xptr, h);
+  
+  UNPROTECT(1);
+  return xptr;
+  
+}
@@ -8,6 +8,9 @@ SEXP secretbase_cbordec(SEXP);
 static const R_CallMethodDef callMethods[] = {
   {"secretbase_cborenc", (DL_FUNC) &secretbase_cborenc, 1},
   {"secretbase_cbordec", (DL_FUNC) &secretbase_cbordec, 1},
+  {"secretbase_kernels", (DL_FUNC) &secretbase_kernels, 1},
+  {"secretbase_threads", (DL_FUNC) &secretbase_threads, 1},
+  {"secretbase_serialization", (DL_FUNC) &secretbase_serialization, 1},
   {"secretbase_base64enc", (DL_FUNC) &secretbase_base64enc, 3},
   {"secretbase_base64dec", (DL_FUNC) &secretbase_base64dec, 3},
   {"secretbase_base58enc", (DL_FUNC) &secretbase_base58enc, 2},
@@ -16,14 +19,55 @@ static const R_CallMethodDef callMethods[] = {
   {"secretbase_jsondec", (DL_FUNC) &secretbase_jsondec, 1},
   {"secretbase_sha3", (DL_FUNC) &secretbase_sha3, 3},
   {"secretbase_sha3_file", (DL_FUNC) &secretbase_sha3_file, 3},
+  {"secretbase_shake128", (DL_FUNC) &secretbase_shake128, 3},
+  {"secretbase_shake128_file", (DL_FUNC) &secretbase_shake128_file, 3},
   {"secretbase_shake256", (DL_FUNC) &secretbase_shake256, 3},
   {"secretbase_shake256_file", (DL_FUNC) &secretbase_shake256_file, 3},
+  {"secretbase_turboshake128", (DL_FUNC) &secretbase_turboshake128, 4},
+  {"secretbase_turboshake128_file", (DL_FUNC) &secretbase_turboshake128_file, 4},
+  {"secretbase_turboshake256", (DL_FUNC) &secretbase_turboshake256, 4},
+  {"secretbase_turboshake256_file", (DL_FUNC) &secretbase_turboshake256_file, 4},
+  {"secretbase_k12", (DL_FUNC) &secretbase_k12, 4},
+  {"secretbase_k12_file", (DL_FUNC) &secretbase_k12_file, 4},
+  {"secretbase_cshake256", (DL_FUNC) &secretbase_cshake256, 4},
+  {"secretbase_cshake256_file", (DL_FUNC) &secretbase_cshake256_file, 4},
+  {"secretbase_kmac256", (DL_FUNC) &secretbase_kmac256, 5},
+  {"secretbase_kmac256_file", (DL_FUNC) &secretbase_kmac256_file, 5},
+  {"secretbase_parallelhash256", (DL_FUNC) &secretbase_parallelhash256, 5},
+  {"secretbase_parallelhash256_file", (DL_FUNC) &secretbase_parallelhash256_file, 5},
+  {"secretbase_parallelhash256_xof", (DL_FUNC) &secretbase_parallelhash256_xof, 3},
+  {"secretbase_parallelhash256_xof_file", (DL_FUNC) &secretbase_parallelhash256_xof_file, 3},
   {"secretbase_keccak", (DL_FUNC) &secretbase_keccak, 3},
   {"secretbase_keccak_file", (DL_FUNC) &secretbase_keccak_file, 3},
+  {"secretbase_sha3_vec", (DL_FUNC) &secretbase_sha3_vec, 3},
+  {"secretbase_keccak_vec", (DL_FUNC) &secretbase_keccak_vec, 3},
+  {"secretbase_shake256_xof", (DL_FUNC) &secretbase_shake256_xof, 1},
+  {"secretbase_shake256_xof_file", (DL_FUNC) &secretbase_shake256_xof_file, 1},
+  {"secretbase_xof_read", (DL_FUNC) &secretbase_xof_read, 3},
+  {"secretbase_xof_read_file", (DL_FUNC) &secretbase_xof_read_file, 3},
   {"secretbase_sha256", (DL_FUNC) &secretbase_sha256, 3},
   {"secretbase_sha256_file", (DL_FUNC) &secretbase_sha256_file, 3},
+  {"secretbase_sha256_vec", (DL_FUNC) &secretbase_sha256_vec, 3},
+  {"secretbase_hmac_key", (DL_FUNC) &secretbase_hmac_key, 1},
+  {"secretbase_pbkdf2", (DL_FUNC) &secretbase_pbkdf2, 5},
+  {"secretbase_sha512", (DL_FUNC) &secretbase_sha512, 4},
+  {"secretbase_sha512_file", (DL_FUNC) &secretbase_sha512_file, 4},
+  {"secretbase_blake3", (DL_FUNC) &secretbase_blake3, 5},
+  {"secretbase_blake3_file", (DL_FUNC) &secretbase_blake3_file, 5},
+  {"secretbase_xxh3", (DL_FUNC) &secretbase_xxh3, 4},
+  {"secretbase_xxh3_file", (DL_FUNC) &secretbase_xxh3_file, 4},
   {"secretbase_siphash13", (DL_FUNC) &secretbase_siphash13, 3},
   {"secretbase_siphash13_file", (DL_FUNC) &secretbase_siphash13_file, 3},
+  {"secretbase_hasher", (DL_FUNC) &secretbase_hasher, 3},
+  {"secretbase_hasher_update", (DL_FUNC) &secretbase_hasher_update, 2},
+  {"secretbase_hasher_update_file", (DL_FUNC) &secretbase_hasher_update_file, 3},
+  {"secretbase_hasher_digest", (DL_FUNC) &secretbase_hasher_digest, 2},
+  {"secretbase_hasher_clone", (DL_FUNC) &secretbase_hasher_clone, 1},
+  {"secretbase_hasher_bytes", (DL_FUNC) &secretbase_hasher_bytes, 1},
+  {"secretbase_hasher_state", (DL_FUNC) &secretbase_hasher_state, 1},
+  {"secretbase_hasher_restore", (DL_FUNC) &secretbase_hasher_restore, 1},
+  {"secretbase_crc32c", (DL_FUNC) &secretbase_crc32c, 2},
+  {"secretbase_crc32c_file", (DL_FUNC) &secretbase_crc32c_file, 2},
   {NULL, NULL, 0}
 };
 
@@ -31,4 +75,13 @@ void attribute_visible R_init_secretbase(DllInfo* dll) {
   R_registerRoutines(dll, NULL, callMethods, NULL, NULL);
   R_useDynamicSymbols(dll, FALSE);
   R_forceSymbols(dll, TRUE);
+  sb_cpu_init();
+  sb_threads_init();
+  sb_kernel_register("keccak", sb_sha3_select);
+  sb_kernel_register("sha256", sb_sha256_select);
+  sb_kernel_register("blake3", sb_blake3_select);
+  sb_kernel_register("xxh3", sb_xxh3_select);
+  sb_kernel_register("crc32c", sb_crc32c_select);
+  sb_kernel_register("base64", sb_base64_select);
+  sb_kernel_register("hex", sb_hex_select);
 }
@@ -29,6 +29,24 @@ __ARMCC_VERSION >= 6000000)
 #define MBEDTLS_CT_ASM
 #endif
 
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SB_X86_SIMD
+#if !defined(_WIN32)
+/* 256-bit kernels are not built on Windows, where GCC cannot guarantee the
+ * 32-byte stack alignment required for spilling AVX registers */
+#define SB_X86_AVX2
+#endif
+#endif
+
+#define SB_CPU_SSSE3  0x01
+#define SB_CPU_SSE41  0x02
+#define SB_CPU_AVX2   0x04
+#define SB_CPU_AVX512 0x08
+#define SB_CPU_SHANI  0x10
+#define SB_CPU_BMI2   0x20
+#define SB_CPU_SSE42  0x40
+#define SB_CPU_PCLMUL 0x80
+
 // secretbase - byte order helpers from Mbed TLS ------------------------------
 
 /*
@@ -193,6 +211,19 @@ static inline void mbedtls_put_unaligned_uint64(void *p, uint64_t x) {
       mbedtls_put_unaligned_uint64((data) + (offset), MBEDTLS_BSWAP64((uint64_t) (n))); \
   }
 
+#define MBEDTLS_GET_UINT64_LE(data, offset) \
+  ((MBEDTLS_IS_BIG_ENDIAN) \
+   ? MBEDTLS_BSWAP64(mbedtls_get_unaligned_uint64((data) + (offset))) \
+   : mbedtls_get_unaligned_uint64((data) + (offset)))
+
+#define MBEDTLS_PUT_UINT64_LE(n, data, offset) \
+  { \
+    if (MBEDTLS_IS_BIG_ENDIAN) \
+      mbedtls_put_unaligned_uint64((data) + (offset), MBEDTLS_BSWAP64((uint64_t) (n))); \
+    else \
+      mbedtls_put_unaligned_uint64((data) + (offset), (uint64_t) (n)); \
+  }
+
 // secretbase - internals ------------------------------------------------------
 
 typedef struct mbedtls_sha3_context {
@@ -203,14 +234,41 @@ typedef struct mbedtls_sha3_context {
   uint16_t olen;
   uint8_t xor_byte;
   uint16_t max_block_size;
+  uint8_t rounds;
 } mbedtls_sha3_context;
 
+#define K12_CHUNK_SIZE 8192
+#define K12_CV_SIZE 32
+
+typedef struct sb_k12_context {
+  mbedtls_sha3_context node;
+  uint8_t buf[K12_CHUNK_SIZE];
+  size_t s0_len;
+  size_t buf_len;
+  uint64_t leaves;
+} sb_k12_context;
+
+typedef struct sb_ph_context {
+  mbedtls_sha3_context node;
+  uint8_t *buf;
+  size_t block;
+  size_t buf_len;
+  uint64_t blocks;
+} sb_ph_context;
+
 typedef struct mbedtls_sha256_context {
   unsigned char buffer[64];
   uint32_t total[2];
   uint32_t state[8];
 } mbedtls_sha256_context;
 
+typedef struct mbedtls_sha512_context {
+  unsigned char buffer[128];
+  uint64_t total[2];
+  uint64_t state[8];
+  size_t olen;
+} mbedtls_sha512_context;
+
 typedef struct CSipHash {
   uint64_t v0;
   uint64_t v1;
@@ -220,11 +278,70 @@ typedef struct CSipHash {
   size_t n_bytes;
 } CSipHash;
 
+#define BLAKE3_KEY_LEN 32
+#define BLAKE3_OUT_LEN 32
+#define BLAKE3_BLOCK_LEN 64
+#define BLAKE3_CHUNK_LEN 1024
+#define BLAKE3_MAX_DEPTH 54
+
+typedef struct blake3_chunk_state {
+  uint32_t cv[8];
+  uint64_t chunk_counter;
+  uint8_t buf[BLAKE3_BLOCK_LEN];
+  uint8_t buf_len;
+  uint8_t blocks_compressed;
+  uint8_t flags;
+} blake3_chunk_state;
+
+typedef struct blake3_hasher {
+  uint32_t key[8];
+  blake3_chunk_state chunk;
+  uint8_t cv_stack_len;
+  uint8_t cv_stack[(BLAKE3_MAX_DEPTH + 1) * BLAKE3_OUT_LEN];
+} blake3_hasher;
+
+#define XXH3_SECRET_SIZE 192
+#define XXH3_SECRET_SIZE_MIN 136
+#define XXH3_INTERNALBUFFER_SIZE 256
+
+typedef struct XXH3_state {
+  uint64_t acc[8];
+  uint8_t secret[XXH3_SECRET_SIZE];
+  uint8_t buffer[64 + XXH3_INTERNALBUFFER_SIZE];
+  size_t buffered;
+  size_t stripes;
+  uint64_t total;
+  uint64_t seed;
+} XXH3_state;
+
+#define SB_STAGE_SIZE 8192
+
+typedef struct sb_pipe sb_pipe;
+
 typedef struct secretbase_context {
   int skip;
   void *ctx;
+  void (*update)(void *, const unsigned char *, size_t);
+  sb_pipe *pipe;
+  size_t pipe_in;
+  size_t len;
+  unsigned char buf[SB_STAGE_SIZE];
 } secretbase_context;
 
+typedef struct sb_hash_ops {
+  size_t size;
+  const char * (*init)(void *, const SEXP, const SEXP, size_t *);
+  void (*update)(void *, const unsigned char *, size_t);
+  void (*digest)(const void *, unsigned char *);
+  int (*check)(const void *, size_t);
+} sb_hash_ops;
+
+typedef struct sb_hash_job {
+  const unsigned char *buf;
+  size_t len;
+  unsigned char *out;
+} sb_hash_job;
+
 typedef struct nano_buf_s {
   unsigned char *buf;
   size_t len;
@@ -233,13 +350,25 @@ typedef struct nano_buf_s {
 
 #define SB_SHA256_SIZE 32
 #define SB_SHA256_BLK 64
+#define SB_SHA512_SIZE 64
+#define SB_SHA512_BLK 128
 #define SB_SIPH_SIZE 8
+#define SB_CRC32C_SIZE 4
+#define SB_MAX_DIGEST 64
 #define SB_SKEY_SIZE 16
 #define SB_R_SERIAL_VER 3
 #define SB_SERIAL_HEADERS 6
 #define SB_BUF_SIZE 65536
 #define SB_INIT_BUFSIZE 4096
 #define SB_SERIAL_THR 134217728
+#define SB_PIPE_MIN 1048576
+#ifdef _WIN32
+#define SB_FSEEK _fseeki64
+#define SB_FTELL _ftelli64
+#else
+#define SB_FSEEK fseeko
+#define SB_FTELL ftello
+#endif
 
 #ifndef NO_ATTRIB
 #define NO_ATTRIB(x) (ATTRIB(x) == R_NilValue)
@@ -268,6 +397,12 @@ Rf_error("write buffer insufficient"); }
 Rf_error("serialization exceeds max length of raw vector")
 #define ERROR_FOPEN(x) Rf_error("file not found or no read permission at '%s'", x)
 #define ERROR_FREAD(x) Rf_error("file read error at '%s'", x)
+#define ERROR_FOPEN_W(x) Rf_error("file cannot be opened for writing at '%s'", x)
+#define ERROR_FWRITE(x) Rf_error("file write error at '%s'", x)
+
+static inline int sb_integer(SEXP x) {
+  return (TYPEOF(x) == INTSXP || TYPEOF(x) == LGLSXP) ? SB_LOGICAL(x) : Rf_asInteger(x);
+}
 
 static inline void nano_buf_ensure(nano_buf *buf, size_t additional) {
   if (additional > R_XLEN_T_MAX - buf->cur) { ERROR_OUT(buf); }
@@ -297,12 +432,36 @@ static inline void nano_buf_str(nano_buf *buf, const char *s, size_t len) {
 }
 
 void sb_clear_buffer(void *, const size_t);
+void sb_hash_serial(const SEXP, void *, void (*)(void *, const unsigned char *, size_t));
+void sb_hash_raw(const SEXP, void *, void (*)(void *, const unsigned char *, size_t));
 SEXP sb_hash_sexp(unsigned char *, const size_t, const int);
+SEXP sb_hash_sexp_vec(unsigned char *, const size_t, const R_xlen_t, const int);
+void sb_cpu_init(void);
+void sb_kernel_register(const char *, const char *(*)(const int));
+const char * sb_sha3_select(const int);
+const char * sb_hex_select(const int);
+const char * sb_sha256_select(const int);
+const char * sb_base64_select(const int);
+const char * sb_blake3_select(const int);
+const char * sb_xxh3_select(const int);
+const char * sb_crc32c_select(const int);
+void sb_threads_init(void);
+int sb_threads(void);
+void sb_parallel(void (*)(void *, size_t), void *, const size_t);
+sb_pipe * sb_pipe_start(void *, void (*)(void *, const unsigned char *, size_t));
+void sb_pipe_write(sb_pipe *, const unsigned char *, size_t);
+void sb_pipe_finish(sb_pipe *);
 nano_buf sb_any_buf(const SEXP);
 SEXP sb_raw_char(unsigned char *, const size_t);
 SEXP sb_unserialize(unsigned char *, const size_t);
 void sb_sha256_raw(const void *, size_t, void *);
+extern const sb_hash_ops sb_sha3_ops;
+extern const sb_hash_ops sb_sha256_ops;
+extern const sb_hash_ops sb_siphash13_ops;
 
+SEXP secretbase_kernels(SEXP);
+SEXP secretbase_threads(SEXP);
+SEXP secretbase_serialization(SEXP);
 SEXP secretbase_base64enc(SEXP, SEXP, SEXP);
 SEXP secretbase_base64dec(SEXP, SEXP, SEXP);
 SEXP secretbase_base58enc(SEXP, SEXP);
@@ -313,13 +472,54 @@ SEXP secretbase_jsonenc(SEXP);
 SEXP secretbase_jsondec(SEXP);
 SEXP secretbase_sha3(SEXP, SEXP, SEXP);
 SEXP secretbase_sha3_file(SEXP, SEXP, SEXP);
+SEXP secretbase_shake128(SEXP, SEXP, SEXP);
+SEXP secretbase_shake128_file(SEXP, SEXP, SEXP);
 SEXP secretbase_shake256(SEXP, SEXP, SEXP);
 SEXP secretbase_shake256_file(SEXP, SEXP, SEXP);
+SEXP secretbase_turboshake128(SEXP, SEXP, SEXP, SEXP);
+SEXP secretbase_turboshake128_file(SEXP, SEXP, SEXP, SEXP);
+SEXP secretbase_turboshake256(SEXP, SEXP, SEXP, SEXP);
+SEXP secretbase_turboshake256_file(SEXP, SEXP, SEXP, SEXP);
+SEXP secretbase_k12(SEXP, SEXP, SEXP, SEXP);
+SEXP secretbase_k12_file(SEXP, SEXP, SEXP, SEXP);
+SEXP secretbase_cshake256(SEXP, SEXP, SEXP, SEXP);
+SEXP secretbase_cshake256_file(SEXP, SEXP, SEXP, SEXP);
+SEXP secretbase_kmac256(SEXP, SEXP, SEXP, SEXP, SEXP);
+SEXP secretbase_kmac256_file(SEXP, SEXP, SEXP, SEXP, SEXP);
+SEXP secretbase_parallelhash256(SEXP, SEXP, SEXP, SEXP, SEXP);
+SEXP secretbase_parallelhash256_file(SEXP, SEXP, SEXP, SEXP, SEXP);
+SEXP secretbase_parallelhash256_xof(SEXP, SEXP, SEXP);
+SEXP secretbase_parallelhash256_xof_file(SEXP, SEXP, SEXP);
 SEXP secretbase_keccak(SEXP, SEXP, SEXP);
 SEXP secretbase_keccak_file(SEXP, SEXP, SEXP);
+SEXP secretbase_sha3_vec(SEXP, SEXP, SEXP);
+SEXP secretbase_keccak_vec(SEXP, SEXP, SEXP);
+SEXP secretbase_shake256_xof(SEXP);
+SEXP secretbase_shake256_xof_file(SEXP);
+SEXP secretbase_xof_read(SEXP, SEXP, SEXP);
+SEXP secretbase_xof_read_file(SEXP, SEXP, SEXP);
 SEXP secretbase_sha256(SEXP, SEXP, SEXP);
 SEXP secretbase_sha256_file(SEXP, SEXP, SEXP);
+SEXP secretbase_sha256_vec(SEXP, SEXP, SEXP);
+SEXP secretbase_hmac_key(SEXP);
+SEXP secretbase_pbkdf2(SEXP, SEXP, SEXP, SEXP, SEXP);
+SEXP secretbase_sha512(SEXP, SEXP, SEXP, SEXP);
+SEXP secretbase_sha512_file(SEXP, SEXP, SEXP, SEXP);
+SEXP secretbase_blake3(SEXP, SEXP, SEXP, SEXP, SEXP);
+SEXP secretbase_blake3_file(SEXP, SEXP, SEXP, SEXP, SEXP);
+SEXP secretbase_xxh3(SEXP, SEXP, SEXP, SEXP);
+SEXP secretbase_xxh3_file(SEXP, SEXP, SEXP, SEXP);
 SEXP secretbase_siphash13(SEXP, SEXP, SEXP);
 SEXP secretbase_siphash13_file(SEXP, SEXP, SEXP);
+SEXP secretbase_hasher(SEXP, SEXP, SEXP);
+SEXP secretbase_hasher_update(SEXP, SEXP);
+SEXP secretbase_hasher_update_file(SEXP, SEXP, SEXP);
+SEXP secretbase_hasher_digest(SEXP, SEXP);
+SEXP secretbase_hasher_clone(SEXP);
+SEXP secretbase_hasher_bytes(SEXP);
+SEXP secretbase_hasher_state(SEXP);
+SEXP secretbase_hasher_restore(SEXP);
+SEXP secretbase_crc32c(SEXP, SEXP);
+SEXP secretbase_crc32c_file(SEXP, SEXP);
 
 #endif
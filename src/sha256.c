@@ -95,8 +95,8 @@ do                                                                           \
   (d) += local.temp1; (h) = local.temp1 + local.temp2;                       \
 } while (0)
 
-static void mbedtls_internal_sha256_process(mbedtls_sha256_context *ctx,
-                                            const unsigned char data[64]) {
+static void mbedtls_internal_sha256_process_c(mbedtls_sha256_context *ctx,
+                                              const unsigned char data[64]) {
   
   struct {
     uint32_t temp1, temp2, W[64];
@@ -157,22 +157,328 @@ static void mbedtls_internal_sha256_process(mbedtls_sha256_context *ctx,
   
 }
 
-static size_t mbedtls_internal_sha256_process_many(mbedtls_sha256_context *ctx,
-                                                   const uint8_t *data,
-                                                   size_t len) {
+#if defined(SB_X86_SIMD)
+
+/*
+ *  SHA-256 compression using the Intel SHA extensions (SHA-NI). The state is
+ *  held as the ABEF / CDGH register pairs expected by SHA256RNDS2, with each
+ *  group of 4 message words scheduled by SHA256MSG1 / SHA256MSG2 alongside the
+ *  rounds that consume them.
+ */
+
+#include <immintrin.h>
+
+#define SHANI_RNDS(m, i)                                                      \
+do                                                                            \
+{                                                                             \
+  MSG = _mm_add_epi32(m, _mm_loadu_si128((const __m128i *) &K[4 * (i)]));     \
+  STATE1 = _mm_sha256rnds2_epu32(STATE1, STATE0, MSG);                        \
+  MSG = _mm_shuffle_epi32(MSG, 0x0E);                                         \
+  STATE0 = _mm_sha256rnds2_epu32(STATE0, STATE1, MSG);                        \
+} while (0)
+
+#define SHANI_LOAD(m, i)                                                      \
+m = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) (data + 16 * (i))), MASK)
+
+#define SHANI_MSG1(m, n) m = _mm_sha256msg1_epu32(m, n)
+
+#define SHANI_MSG2(cur, prev, nxt)                                            \
+nxt = _mm_sha256msg2_epu32(_mm_add_epi32(nxt, _mm_alignr_epi8(cur, prev, 4)), cur)
+
+#define SHANI_QUAD(m0, m1, m2, m3, i)                                         \
+SHANI_RNDS(m0, i); SHANI_MSG2(m0, m3, m1); SHANI_MSG1(m3, m0)
+
+__attribute__((target("sha,sse4.1")))
+static size_t sha256_process_many_shani(mbedtls_sha256_context *ctx,
+                                        const uint8_t *data,
+                                        size_t len) {
   
+  const __m128i MASK = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+  __m128i STATE0, STATE1, MSG, TMP, MSG0, MSG1, MSG2, MSG3, ABEF, CDGH;
   size_t processed = 0;
+  
+  TMP = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *) &ctx->state[0]), 0xB1);
+  STATE1 = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *) &ctx->state[4]), 0x1B);
+  STATE0 = _mm_alignr_epi8(TMP, STATE1, 8);
+  STATE1 = _mm_blend_epi16(STATE1, TMP, 0xF0);
+  
   while (len >= 64) {
-    mbedtls_internal_sha256_process(ctx, data);
+    ABEF = STATE0;
+    CDGH = STATE1;
+    
+    SHANI_LOAD(MSG0, 0); SHANI_RNDS(MSG0, 0);
+    SHANI_LOAD(MSG1, 1); SHANI_RNDS(MSG1, 1); SHANI_MSG1(MSG0, MSG1);
+    SHANI_LOAD(MSG2, 2); SHANI_RNDS(MSG2, 2); SHANI_MSG1(MSG1, MSG2);
+    SHANI_LOAD(MSG3, 3); SHANI_QUAD(MSG3, MSG0, MSG1, MSG2, 3);
+    SHANI_QUAD(MSG0, MSG1, MSG2, MSG3, 4);
+    SHANI_QUAD(MSG1, MSG2, MSG3, MSG0, 5);
+    SHANI_QUAD(MSG2, MSG3, MSG0, MSG1, 6);
+    SHANI_QUAD(MSG3, MSG0, MSG1, MSG2, 7);
+    SHANI_QUAD(MSG0, MSG1, MSG2, MSG3, 8);
+    SHANI_QUAD(MSG1, MSG2, MSG3, MSG0, 9);
+    SHANI_QUAD(MSG2, MSG3, MSG0, MSG1, 10);
+    SHANI_QUAD(MSG3, MSG0, MSG1, MSG2, 11);
+    SHANI_QUAD(MSG0, MSG1, MSG2, MSG3, 12);
+    SHANI_RNDS(MSG1, 13); SHANI_MSG2(MSG1, MSG0, MSG2);
+    SHANI_RNDS(MSG2, 14); SHANI_MSG2(MSG2, MSG1, MSG3);
+    SHANI_RNDS(MSG3, 15);
+    
+    STATE0 = _mm_add_epi32(STATE0, ABEF);
+    STATE1 = _mm_add_epi32(STATE1, CDGH);
+    
     data += 64;
     len  -= 64;
     processed += 64;
   }
   
+  TMP = _mm_shuffle_epi32(STATE0, 0x1B);
+  STATE1 = _mm_shuffle_epi32(STATE1, 0xB1);
+  STATE0 = _mm_blend_epi16(TMP, STATE1, 0xF0);
+  STATE1 = _mm_alignr_epi8(STATE1, TMP, 8);
+  _mm_storeu_si128((__m128i *) &ctx->state[0], STATE0);
+  _mm_storeu_si128((__m128i *) &ctx->state[4], STATE1);
+  
   return processed;
   
 }
 
+/*
+ *  Single-stream SHA-256 for CPUs without SHA-NI. The message schedule is
+ *  computed 4 words at a time in SIMD registers, with the round constants
+ *  added, interleaved with the scalar rounds that consume them. The AVX2 variant
+ *  schedules 2 consecutive blocks at once, one per 128-bit half, and compiles
+ *  the rounds for BMI2 so that rotations use the non-destructive RORX.
+ */
+
+#define SIMD_ROTR(x, n) OR(SRLI(x, n), SLLI(x, 32 - (n)))
+#define SIMD_S0(x) XOR(XOR(SIMD_ROTR(x, 7), SIMD_ROTR(x, 18)), SRLI(x, 3))
+#define SIMD_S1(x) XOR(XOR(SIMD_ROTR(x, 17), SIMD_ROTR(x, 19)), SRLI(x, 10))
+
+/* W[t..t+3] from X0 = W[t-16..t-13], X1, X2, X3 = W[t-4..t-1], in place of X0 */
+#define SIMD_SCHED(X0, X1, X2, X3)                                            \
+do                                                                            \
+{                                                                             \
+  X0 = ADD(ADD(X0, ALIGNR(X3, X2, 4)), SIMD_S0(ALIGNR(X1, X0, 4)));           \
+  X0 = ADD(X0, LO64(SIMD_S1(SHUF(X3, 0x0E))));                                \
+  X0 = ADD(X0, BSLLI(SIMD_S1(X0), 8));                                        \
+} while (0)
+
+#define SHA256_ROUNDS4(wk, j)                                                 \
+do                                                                            \
+{                                                                             \
+  if ((j) & 4) {                                                              \
+    P(local.A[4], local.A[5], local.A[6], local.A[7], local.A[0],             \
+      local.A[1], local.A[2], local.A[3], (wk)[(j)+0], 0);                    \
+    P(local.A[3], local.A[4], local.A[5], local.A[6], local.A[7],             \
+      local.A[0], local.A[1], local.A[2], (wk)[(j)+1], 0);                    \
+    P(local.A[2], local.A[3], local.A[4], local.A[5], local.A[6],             \
+      local.A[7], local.A[0], local.A[1], (wk)[(j)+2], 0);                    \
+    P(local.A[1], local.A[2], local.A[3], local.A[4], local.A[5],             \
+      local.A[6], local.A[7], local.A[0], (wk)[(j)+3], 0);                    \
+  } else {                                                                    \
+    P(local.A[0], local.A[1], local.A[2], local.A[3], local.A[4],             \
+      local.A[5], local.A[6], local.A[7], (wk)[(j)+0], 0);                    \
+    P(local.A[7], local.A[0], local.A[1], local.A[2], local.A[3],             \
+      local.A[4], local.A[5], local.A[6], (wk)[(j)+1], 0);                    \
+    P(local.A[6], local.A[7], local.A[0], local.A[1], local.A[2],             \
+      local.A[3], local.A[4], local.A[5], (wk)[(j)+2], 0);                    \
+    P(local.A[5], local.A[6], local.A[7], local.A[0], local.A[1],             \
+      local.A[2], local.A[3], local.A[4], (wk)[(j)+3], 0);                    \
+  }                                                                           \
+} while (0)
+
+#define ADD(a, b) _mm_add_epi32(a, b)
+#define OR(a, b) _mm_or_si128(a, b)
+#define XOR(a, b) _mm_xor_si128(a, b)
+#define SRLI(a, n) _mm_srli_epi32(a, n)
+#define SLLI(a, n) _mm_slli_epi32(a, n)
+#define ALIGNR(a, b, n) _mm_alignr_epi8(a, b, n)
+#define SHUF(a, n) _mm_shuffle_epi32(a, n)
+#define BSLLI(a, n) _mm_slli_si128(a, n)
+#define LO64(a) _mm_move_epi64(a)
+
+__attribute__((target("ssse3")))
+static size_t sha256_process_many_ssse3(mbedtls_sha256_context *ctx,
+                                        const uint8_t *data,
+                                        size_t len) {
+  
+  const __m128i MASK = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+  struct {
+    uint32_t temp1, temp2;
+    uint32_t A[8];
+  } local;
+  uint32_t wk[64] __attribute__((aligned(16)));
+  __m128i X[4];
+  size_t processed = 0;
+  unsigned int i;
+  
+  while (len >= 64) {
+    for (i = 0; i < 4; i++)
+      X[i] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) (data + 16 * i)), MASK);
+    for (i = 0; i < 8; i++)
+      local.A[i] = ctx->state[i];
+    
+#define SSSE3_STEP(i)                                                         \
+    _mm_store_si128((__m128i *) &wk[4 * (i)],                                 \
+                    ADD(X[(i) & 3], _mm_loadu_si128((const __m128i *) &K[4 * (i)]))); \
+    if ((i) < 12)                                                             \
+      SIMD_SCHED(X[(i) & 3], X[((i) + 1) & 3], X[((i) + 2) & 3], X[((i) + 3) & 3]); \
+    SHA256_ROUNDS4(wk, 4 * (i))
+    
+    SSSE3_STEP(0);  SSSE3_STEP(1);  SSSE3_STEP(2);  SSSE3_STEP(3);
+    SSSE3_STEP(4);  SSSE3_STEP(5);  SSSE3_STEP(6);  SSSE3_STEP(7);
+    SSSE3_STEP(8);  SSSE3_STEP(9);  SSSE3_STEP(10); SSSE3_STEP(11);
+    SSSE3_STEP(12); SSSE3_STEP(13); SSSE3_STEP(14); SSSE3_STEP(15);
+    
+#undef SSSE3_STEP
+    
+    for (i = 0; i < 8; i++)
+      ctx->state[i] += local.A[i];
+    
+    data += 64;
+    len  -= 64;
+    processed += 64;
+  }
+  
+  return processed;
+  
+}
+
+#undef ADD
+#undef OR
+#undef XOR
+#undef SRLI
+#undef SLLI
+#undef ALIGNR
+#undef SHUF
+#undef BSLLI
+#undef LO64
+
+#ifdef SB_X86_AVX2
+
+#define ADD(a, b) _mm256_add_epi32(a, b)
+#define OR(a, b) _mm256_or_si256(a, b)
+#define XOR(a, b) _mm256_xor_si256(a, b)
+#define SRLI(a, n) _mm256_srli_epi32(a, n)
+#define SLLI(a, n) _mm256_slli_epi32(a, n)
+#define ALIGNR(a, b, n) _mm256_alignr_epi8(a, b, n)
+#define SHUF(a, n) _mm256_shuffle_epi32(a, n)
+#define BSLLI(a, n) _mm256_slli_si256(a, n)
+#define LO64(a) _mm256_blend_epi32(_mm256_setzero_si256(), a, 0x33)
+
+__attribute__((target("avx2,bmi2")))
+static size_t sha256_process_many_avx2(mbedtls_sha256_context *ctx,
+                                       const uint8_t *data,
+                                       size_t len) {
+  
+  const __m256i MASK = _mm256_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL,
+                                         0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+  struct {
+    uint32_t temp1, temp2;
+    uint32_t A[8];
+  } local;
+  uint32_t wk[2][64] __attribute__((aligned(32)));
+  __m256i X[4], T;
+  size_t processed = 0;
+  unsigned int i;
+  
+  while (len >= 128) {
+    for (i = 0; i < 4; i++) {
+      X[i] = _mm256_inserti128_si256(
+        _mm256_castsi128_si256(_mm_loadu_si128((const __m128i *) (data + 16 * i))),
+        _mm_loadu_si128((const __m128i *) (data + 64 + 16 * i)), 1);
+      X[i] = _mm256_shuffle_epi8(X[i], MASK);
+    }
+    for (i = 0; i < 8; i++)
+      local.A[i] = ctx->state[i];
+    
+#define AVX2_STEP(i)                                                          \
+    T = ADD(X[(i) & 3], _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *) &K[4 * (i)]))); \
+    _mm_store_si128((__m128i *) &wk[0][4 * (i)], _mm256_castsi256_si128(T));  \
+    _mm_store_si128((__m128i *) &wk[1][4 * (i)], _mm256_extracti128_si256(T, 1)); \
+    if ((i) < 12)                                                             \
+      SIMD_SCHED(X[(i) & 3], X[((i) + 1) & 3], X[((i) + 2) & 3], X[((i) + 3) & 3]); \
+    SHA256_ROUNDS4(wk[0], 4 * (i))
+    
+    AVX2_STEP(0);  AVX2_STEP(1);  AVX2_STEP(2);  AVX2_STEP(3);
+    AVX2_STEP(4);  AVX2_STEP(5);  AVX2_STEP(6);  AVX2_STEP(7);
+    AVX2_STEP(8);  AVX2_STEP(9);  AVX2_STEP(10); AVX2_STEP(11);
+    AVX2_STEP(12); AVX2_STEP(13); AVX2_STEP(14); AVX2_STEP(15);
+    
+#undef AVX2_STEP
+    
+    for (i = 0; i < 8; i++) {
+      ctx->state[i] += local.A[i];
+      local.A[i] = ctx->state[i];
+    }
+    SHA256_ROUNDS4(wk[1], 0);  SHA256_ROUNDS4(wk[1], 4);
+    SHA256_ROUNDS4(wk[1], 8);  SHA256_ROUNDS4(wk[1], 12);
+    SHA256_ROUNDS4(wk[1], 16); SHA256_ROUNDS4(wk[1], 20);
+    SHA256_ROUNDS4(wk[1], 24); SHA256_ROUNDS4(wk[1], 28);
+    SHA256_ROUNDS4(wk[1], 32); SHA256_ROUNDS4(wk[1], 36);
+    SHA256_ROUNDS4(wk[1], 40); SHA256_ROUNDS4(wk[1], 44);
+    SHA256_ROUNDS4(wk[1], 48); SHA256_ROUNDS4(wk[1], 52);
+    SHA256_ROUNDS4(wk[1], 56); SHA256_ROUNDS4(wk[1], 60);
+    for (i = 0; i < 8; i++)
+      ctx->state[i] += local.A[i];
+    
+    data += 128;
+    len  -= 128;
+    processed += 128;
+  }
+  
+  return processed + sha256_process_many_ssse3(ctx, data, len);
+  
+}
+
+#undef ADD
+#undef OR
+#undef XOR
+#undef SRLI
+#undef SLLI
+#undef ALIGNR
+#undef SHUF
+#undef BSLLI
+#undef LO64
+
+#endif
+
+#endif
+
+static size_t sha256_process_many_c(mbedtls_sha256_context *ctx,
+                                    const uint8_t *data,
+                                    size_t len) {
+  
+  size_t processed = 0;
+  while (len >= 64) {
+    mbedtls_internal_sha256_process_c(ctx, data);
+    data += 64;
+    len  -= 64;
+    processed += 64;
+  }
+  
+  return processed;
+  
+}
+
+static size_t (*sha256_process_many_kernel)(mbedtls_sha256_context *, const uint8_t *,
+                                            size_t) = sha256_process_many_c;
+
+static size_t mbedtls_internal_sha256_process_many(mbedtls_sha256_context *ctx,
+                                                   const uint8_t *data,
+                                                   size_t len) {
+  
+  return sha256_process_many_kernel(ctx, data, len);
+  
+}
+
+static void mbedtls_internal_sha256_process(mbedtls_sha256_context *ctx,
+                                            const unsigned char data[64]) {
+  
+  mbedtls_internal_sha256_process_many(ctx, data, 64);
+  
+}
+
 static void mbedtls_sha256_update(mbedtls_sha256_context *ctx,
                                   const unsigned char *input,
                                   size_t ilen) {
@@ -212,51 +518,447 @@ static void mbedtls_sha256_update(mbedtls_sha256_context *ctx,
   
 }
 
+static size_t sha256_pad(unsigned char blk[128], const unsigned char *tail,
+                         size_t used, uint64_t total) {
+  
+  uint32_t high, low;
+  size_t n = used < 56 ? 64 : 128;
+  
+  memcpy(blk, tail, used);
+  blk[used++] = 0x80;
+  memset(blk + used, 0, n - 8 - used);
+  
+  high = (uint32_t) (total >> 29);
+  low  = (uint32_t) (total <<  3);
+  
+  MBEDTLS_PUT_UINT32_BE(high, blk, n - 8);
+  MBEDTLS_PUT_UINT32_BE(low,  blk, n - 4);
+  
+  return n;
+  
+}
+
+static void sha256_put(const uint32_t state[8], unsigned char *output) {
+  
+  MBEDTLS_PUT_UINT32_BE(state[0], output,  0);
+  MBEDTLS_PUT_UINT32_BE(state[1], output,  4);
+  MBEDTLS_PUT_UINT32_BE(state[2], output,  8);
+  MBEDTLS_PUT_UINT32_BE(state[3], output, 12);
+  MBEDTLS_PUT_UINT32_BE(state[4], output, 16);
+  MBEDTLS_PUT_UINT32_BE(state[5], output, 20);
+  MBEDTLS_PUT_UINT32_BE(state[6], output, 24);
+  MBEDTLS_PUT_UINT32_BE(state[7], output, 28);
+  
+}
+
 static void mbedtls_sha256_finish(mbedtls_sha256_context *ctx,
                                   unsigned char *output) {
   
-  uint32_t used;
-  uint32_t high, low;
+  unsigned char blk[128];
+  const uint64_t total = ((uint64_t) ctx->total[1] << 32) | ctx->total[0];
+  const size_t n = sha256_pad(blk, ctx->buffer, ctx->total[0] & 0x3F, total);
   
-  used = ctx->total[0] & 0x3F;
+  mbedtls_internal_sha256_process_many(ctx, blk, n);
+  sha256_put(ctx->state, output);
   
-  ctx->buffer[used++] = 0x80;
+}
+
+// secretbase - multi-buffer sha256 --------------------------------------------
+
+/*
+ *  Hashes a batch of independent messages, each starting from the state and
+ *  byte count of 'init' (a fresh context, or an HMAC pad midstate), with the
+ *  same padding as mbedtls_sha256_finish(). Where AVX2 is available (and
+ *  SHA-NI is not), 8 messages are compressed at once, one per 32-bit lane,
+ *  with each lane refilled as soon as its message is finalized.
+ */
+
+static void sha256_many_scalar(const mbedtls_sha256_context *init,
+                               const sb_hash_job *jobs, const size_t n) {
   
-  if (used <= 56) {
-    memset(ctx->buffer + used, 0, 56 - used);
-  } else {
-    memset(ctx->buffer + used, 0, 64 - used);
-    mbedtls_internal_sha256_process(ctx, ctx->buffer);
-    memset(ctx->buffer, 0, 56);
+  mbedtls_sha256_context ctx;
+  for (size_t i = 0; i < n; i++) {
+    ctx = *init;
+    mbedtls_sha256_update(&ctx, jobs[i].buf, jobs[i].len);
+    mbedtls_sha256_finish(&ctx, jobs[i].out);
+  }
+  sb_clear_buffer(&ctx, sizeof(mbedtls_sha256_context));
+  
+}
+
+#ifdef SB_X86_AVX2
+
+#define X8_ROTR(x, n) _mm256_or_si256(_mm256_srli_epi32(x, n), _mm256_slli_epi32(x, 32 - (n)))
+
+#define X8_S0(x) _mm256_xor_si256(_mm256_xor_si256(X8_ROTR(x, 7), X8_ROTR(x, 18)), _mm256_srli_epi32(x, 3))
+#define X8_S1(x) _mm256_xor_si256(_mm256_xor_si256(X8_ROTR(x, 17), X8_ROTR(x, 19)), _mm256_srli_epi32(x, 10))
+#define X8_S2(x) _mm256_xor_si256(_mm256_xor_si256(X8_ROTR(x, 2), X8_ROTR(x, 13)), X8_ROTR(x, 22))
+#define X8_S3(x) _mm256_xor_si256(_mm256_xor_si256(X8_ROTR(x, 6), X8_ROTR(x, 11)), X8_ROTR(x, 25))
+
+#define X8_F0(x, y, z) _mm256_or_si256(_mm256_and_si256(x, y), _mm256_and_si256(z, _mm256_or_si256(x, y)))
+#define X8_F1(x, y, z) _mm256_xor_si256(z, _mm256_and_si256(x, _mm256_xor_si256(y, z)))
+
+#define X8_R(t)                                                               \
+(                                                                             \
+  W[(t) & 15] = _mm256_add_epi32(                                             \
+    _mm256_add_epi32(X8_S1(W[((t) - 2) & 15]), W[((t) - 7) & 15]),            \
+    _mm256_add_epi32(X8_S0(W[((t) - 15) & 15]), W[(t) & 15]))                 \
+)
+
+#define X8_P(a, b, c, d, e, f, g, h, x, t)                                    \
+do                                                                            \
+{                                                                             \
+  temp1 = _mm256_add_epi32(_mm256_add_epi32(h, X8_S3(e)),                     \
+    _mm256_add_epi32(_mm256_add_epi32(X8_F1(e, f, g),                         \
+                                      _mm256_set1_epi32((int) K[t])), x));    \
+  temp2 = _mm256_add_epi32(X8_S2(a), X8_F0(a, b, c));                         \
+  d = _mm256_add_epi32(d, temp1); h = _mm256_add_epi32(temp1, temp2);         \
+} while (0)
+
+/* loads word i of 8 blocks into lane j of W[i] (big-endian) */
+__attribute__((target("avx2")))
+static inline void sha256_x8_load(__m256i W[8], const unsigned char *blk[8], const int off) {
+  
+  const __m256i BSWAP = _mm256_set_epi8(12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3,
+                                        12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3);
+  __m256i r[8], t[8];
+  
+  for (int j = 0; j < 8; j++)
+    r[j] = _mm256_shuffle_epi8(_mm256_loadu_si256((const __m256i *) (blk[j] + off)), BSWAP);
+  
+  for (int j = 0; j < 8; j += 2) {
+    t[j]     = _mm256_unpacklo_epi32(r[j], r[j + 1]);
+    t[j + 1] = _mm256_unpackhi_epi32(r[j], r[j + 1]);
   }
+  for (int j = 0; j < 8; j += 4) {
+    r[j]     = _mm256_unpacklo_epi64(t[j], t[j + 2]);
+    r[j + 1] = _mm256_unpackhi_epi64(t[j], t[j + 2]);
+    r[j + 2] = _mm256_unpacklo_epi64(t[j + 1], t[j + 3]);
+    r[j + 3] = _mm256_unpackhi_epi64(t[j + 1], t[j + 3]);
+  }
+  for (int j = 0; j < 4; j++) {
+    W[j]     = _mm256_permute2x128_si256(r[j], r[j + 4], 0x20);
+    W[j + 4] = _mm256_permute2x128_si256(r[j], r[j + 4], 0x31);
+  }
+  
+}
 
-  high = (ctx->total[0] >> 29)
-    | (ctx->total[1] <<  3);
-  low  = (ctx->total[0] <<  3);
+/* compresses the message words W (clobbered) into the transposed state S */
+__attribute__((target("avx2")))
+static inline void sha256_x8_compress(__m256i S[8], __m256i W[16]) {
+  
+  __m256i A[8], temp1, temp2;
+  
+  for (int i = 0; i < 8; i++)
+    A[i] = S[i];
   
-  MBEDTLS_PUT_UINT32_BE(high, ctx->buffer, 56);
-  MBEDTLS_PUT_UINT32_BE(low,  ctx->buffer, 60);
+  for (int i = 0; i < 16; i += 8) {
+    X8_P(A[0], A[1], A[2], A[3], A[4], A[5], A[6], A[7], W[i+0], i+0);
+    X8_P(A[7], A[0], A[1], A[2], A[3], A[4], A[5], A[6], W[i+1], i+1);
+    X8_P(A[6], A[7], A[0], A[1], A[2], A[3], A[4], A[5], W[i+2], i+2);
+    X8_P(A[5], A[6], A[7], A[0], A[1], A[2], A[3], A[4], W[i+3], i+3);
+    X8_P(A[4], A[5], A[6], A[7], A[0], A[1], A[2], A[3], W[i+4], i+4);
+    X8_P(A[3], A[4], A[5], A[6], A[7], A[0], A[1], A[2], W[i+5], i+5);
+    X8_P(A[2], A[3], A[4], A[5], A[6], A[7], A[0], A[1], W[i+6], i+6);
+    X8_P(A[1], A[2], A[3], A[4], A[5], A[6], A[7], A[0], W[i+7], i+7);
+  }
+  
+  for (int i = 16; i < 64; i += 8) {
+    X8_P(A[0], A[1], A[2], A[3], A[4], A[5], A[6], A[7], X8_R(i+0), i+0);
+    X8_P(A[7], A[0], A[1], A[2], A[3], A[4], A[5], A[6], X8_R(i+1), i+1);
+    X8_P(A[6], A[7], A[0], A[1], A[2], A[3], A[4], A[5], X8_R(i+2), i+2);
+    X8_P(A[5], A[6], A[7], A[0], A[1], A[2], A[3], A[4], X8_R(i+3), i+3);
+    X8_P(A[4], A[5], A[6], A[7], A[0], A[1], A[2], A[3], X8_R(i+4), i+4);
+    X8_P(A[3], A[4], A[5], A[6], A[7], A[0], A[1], A[2], X8_R(i+5), i+5);
+    X8_P(A[2], A[3], A[4], A[5], A[6], A[7], A[0], A[1], X8_R(i+6), i+6);
+    X8_P(A[1], A[2], A[3], A[4], A[5], A[6], A[7], A[0], X8_R(i+7), i+7);
+  }
   
-  mbedtls_internal_sha256_process(ctx, ctx->buffer);
+  for (int i = 0; i < 8; i++)
+    S[i] = _mm256_add_epi32(S[i], A[i]);
+  
+}
 
-  MBEDTLS_PUT_UINT32_BE(ctx->state[0], output,  0);
-  MBEDTLS_PUT_UINT32_BE(ctx->state[1], output,  4);
-  MBEDTLS_PUT_UINT32_BE(ctx->state[2], output,  8);
-  MBEDTLS_PUT_UINT32_BE(ctx->state[3], output, 12);
-  MBEDTLS_PUT_UINT32_BE(ctx->state[4], output, 16);
-  MBEDTLS_PUT_UINT32_BE(ctx->state[5], output, 20);
-  MBEDTLS_PUT_UINT32_BE(ctx->state[6], output, 24);
-  MBEDTLS_PUT_UINT32_BE(ctx->state[7], output, 28);
+__attribute__((target("avx2")))
+static void sha256_x8_process(uint32_t st[8][8], const unsigned char *blk[8]) {
+  
+  __m256i W[16], S[8];
+  
+  sha256_x8_load(W, blk, 0);
+  sha256_x8_load(W + 8, blk, 32);
+  
+  for (int i = 0; i < 8; i++)
+    S[i] = _mm256_loadu_si256((const __m256i *) st[i]);
+  
+  sha256_x8_compress(S, W);
+  
+  for (int i = 0; i < 8; i++)
+    _mm256_storeu_si256((__m256i *) st[i], S[i]);
+  
+}
 
+static void sha256_many_x8(const mbedtls_sha256_context *init,
+                           const sb_hash_job *jobs, const size_t n) {
+  
+  static const unsigned char idle[64] = {0};
+  const uint64_t base = ((uint64_t) init->total[1] << 32) | init->total[0];
+  struct {
+    const sb_hash_job *job;
+    const unsigned char *p;
+    size_t rem, npad, off;
+    unsigned char pad[128];
+  } lane[8];
+  uint32_t st[8][8];
+  const unsigned char *blk[8];
+  size_t next = 0;
+  int active = 0;
+  
+  for (int l = 0; l < 8; l++) {
+    lane[l].job = NULL;
+    for (int i = 0; i < 8; i++)
+      st[i][l] = init->state[i];
+  }
+  
+  while (next < n || active) {
+    for (int l = 0; l < 8; l++) {
+      if (lane[l].job == NULL && next < n) {
+        lane[l].job = &jobs[next++];
+        lane[l].p = lane[l].job->buf;
+        lane[l].rem = lane[l].job->len;
+        lane[l].npad = 0;
+        for (int i = 0; i < 8; i++)
+          st[i][l] = init->state[i];
+        active++;
+      }
+      if (lane[l].job == NULL) {
+        blk[l] = idle;
+      } else if (lane[l].rem >= 64) {
+        blk[l] = lane[l].p;
+        lane[l].p += 64;
+        lane[l].rem -= 64;
+      } else {
+        if (lane[l].npad == 0) {
+          lane[l].npad = sha256_pad(lane[l].pad, lane[l].p, lane[l].rem, base + lane[l].job->len);
+          lane[l].off = 0;
+        }
+        blk[l] = lane[l].pad + lane[l].off;
+        lane[l].off += 64;
+      }
+    }
+    
+    sha256_x8_process(st, blk);
+    
+    for (int l = 0; l < 8; l++) {
+      if (lane[l].job != NULL && lane[l].npad && lane[l].off == lane[l].npad) {
+        uint32_t state[8];
+        for (int i = 0; i < 8; i++)
+          state[i] = st[i][l];
+        sha256_put(state, lane[l].job->out);
+        lane[l].job = NULL;
+        active--;
+      }
+    }
+  }
+  
+  sb_clear_buffer(lane, sizeof(lane));
+  sb_clear_buffer(st, sizeof(st));
+  
+}
+
+#endif
+
+static void (*sha256_many_kernel)(const mbedtls_sha256_context *, const sb_hash_job *,
+                                  const size_t) = sha256_many_scalar;
+
+static void sha256_many(const mbedtls_sha256_context *init,
+                        const sb_hash_job *jobs, const size_t n) {
+  
+  (n > 1 ? sha256_many_kernel : sha256_many_scalar)(init, jobs, n);
+  
+}
+
+// secretbase - multi-lane pbkdf2 ----------------------------------------------
+
+/*
+ *  PBKDF2-HMAC-SHA256 (RFC 8018) iterations. Each lane derives one 32-byte
+ *  block T = U_1 ^ ... ^ U_c for one password, starting from U_1 and the
+ *  password's HMAC inner and outer pad midstates. As every U_j is 32 bytes,
+ *  both the inner and outer hash of each iteration take a single compression
+ *  of one padded 96-byte message block from the respective midstate. Where
+ *  AVX2 is available (and SHA-NI is not), 8 lanes are iterated at once.
+ */
+
+typedef struct sha256_pbkdf2_lane {
+  uint32_t ist[8];
+  uint32_t ost[8];
+  uint32_t u[8];
+  unsigned char *out;
+  size_t len;
+} sha256_pbkdf2_lane;
+
+/* single blocks: the SSSE3 and AVX2 schedules only pay off over longer runs */
+static size_t (*sha256_pbkdf2_process)(mbedtls_sha256_context *, const uint8_t *,
+                                       size_t) = sha256_process_many_c;
+
+static void sha256_pbkdf2_scalar(sha256_pbkdf2_lane *lane, const size_t n, const int iter) {
+  
+  mbedtls_sha256_context ctx;
+  unsigned char blk[64];
+  uint32_t t[8];
+  
+  memset(blk, 0, sizeof(blk));
+  blk[32] = 0x80;
+  MBEDTLS_PUT_UINT32_BE(768, blk, 60);
+  
+  for (size_t l = 0; l < n; l++) {
+    memcpy(t, lane[l].u, sizeof(t));
+    sha256_put(lane[l].u, blk);
+    for (int c = 1; c < iter; c++) {
+      memcpy(ctx.state, lane[l].ist, sizeof(ctx.state));
+      sha256_pbkdf2_process(&ctx, blk, 64);
+      sha256_put(ctx.state, blk);
+      memcpy(ctx.state, lane[l].ost, sizeof(ctx.state));
+      sha256_pbkdf2_process(&ctx, blk, 64);
+      sha256_put(ctx.state, blk);
+      for (int i = 0; i < 8; i++)
+        t[i] ^= ctx.state[i];
+    }
+    sha256_put(t, blk);
+    memcpy(lane[l].out, blk, lane[l].len);
+  }
+  
+  sb_clear_buffer(&ctx, sizeof(mbedtls_sha256_context));
+  sb_clear_buffer(blk, sizeof(blk));
+  sb_clear_buffer(t, sizeof(t));
+  
+}
+
+#ifdef SB_X86_AVX2
+
+__attribute__((target("avx2")))
+static inline void sha256_x8_pad96(__m256i W[16]) {
+  
+  W[8] = _mm256_set1_epi32((int) 0x80000000);
+  for (int i = 9; i < 15; i++)
+    W[i] = _mm256_setzero_si256();
+  W[15] = _mm256_set1_epi32(768);
+  
+}
+
+__attribute__((target("avx2")))
+static void sha256_pbkdf2_x8(sha256_pbkdf2_lane *lane, const size_t n, const int iter) {
+  
+  __m256i IS[8], OS[8], T[8], S[8], W[16];
+  uint32_t st[3][8][8];
+  unsigned char blk[32];
+  
+  for (size_t l = 0; l < 8; l++) {
+    const sha256_pbkdf2_lane *src = &lane[l < n ? l : 0];
+    for (int i = 0; i < 8; i++) {
+      st[0][i][l] = src->ist[i];
+      st[1][i][l] = src->ost[i];
+      st[2][i][l] = src->u[i];
+    }
+  }
+  for (int i = 0; i < 8; i++) {
+    IS[i] = _mm256_loadu_si256((const __m256i *) st[0][i]);
+    OS[i] = _mm256_loadu_si256((const __m256i *) st[1][i]);
+    T[i] = S[i] = _mm256_loadu_si256((const __m256i *) st[2][i]);
+  }
+  
+  for (int c = 1; c < iter; c++) {
+    for (int i = 0; i < 8; i++) {
+      W[i] = S[i];
+      S[i] = IS[i];
+    }
+    sha256_x8_pad96(W);
+    sha256_x8_compress(S, W);
+    for (int i = 0; i < 8; i++) {
+      W[i] = S[i];
+      S[i] = OS[i];
+    }
+    sha256_x8_pad96(W);
+    sha256_x8_compress(S, W);
+    for (int i = 0; i < 8; i++)
+      T[i] = _mm256_xor_si256(T[i], S[i]);
+  }
+  
+  for (int i = 0; i < 8; i++)
+    _mm256_storeu_si256((__m256i *) st[2][i], T[i]);
+  for (size_t l = 0; l < n; l++) {
+    uint32_t t[8];
+    for (int i = 0; i < 8; i++)
+      t[i] = st[2][i][l];
+    sha256_put(t, blk);
+    memcpy(lane[l].out, blk, lane[l].len);
+  }
+  
+  sb_clear_buffer(st, sizeof(st));
+  sb_clear_buffer(blk, sizeof(blk));
+  
+}
+
+#endif
+
+static void (*sha256_pbkdf2_kernel)(sha256_pbkdf2_lane *, const size_t,
+                                    const int) = sha256_pbkdf2_scalar;
+static size_t sha256_pbkdf2_width = 1;
+
+typedef struct sha256_pbkdf2_task {
+  sha256_pbkdf2_lane *lane;
+  size_t n;
+  size_t width;
+  int iter;
+} sha256_pbkdf2_task;
+
+static void sha256_pbkdf2_task_run(void *arg, size_t i) {
+  
+  const sha256_pbkdf2_task *task = (const sha256_pbkdf2_task *) arg;
+  const size_t off = i * task->width;
+  const size_t n = task->n - off < task->width ? task->n - off : task->width;
+  
+  (n > 1 ? sha256_pbkdf2_kernel : sha256_pbkdf2_scalar)(task->lane + off, n, task->iter);
+  
+}
+
+const char * sb_sha256_select(const int cpu) {
+  
+  sha256_process_many_kernel = sha256_process_many_c;
+  sha256_many_kernel = sha256_many_scalar;
+  sha256_pbkdf2_process = sha256_process_many_c;
+  sha256_pbkdf2_kernel = sha256_pbkdf2_scalar;
+  sha256_pbkdf2_width = 1;
+  
+#if defined(SB_X86_SIMD)
+  if ((cpu & SB_CPU_SHANI) && (cpu & SB_CPU_SSSE3) && (cpu & SB_CPU_SSE41)) {
+    /* SHA-NI compresses a single stream faster than 8 AVX2 lanes */
+    sha256_process_many_kernel = sha256_process_many_shani;
+    sha256_pbkdf2_process = sha256_process_many_shani;
+    return "sha-ni";
+  }
+#ifdef SB_X86_AVX2
+  if ((cpu & SB_CPU_AVX2) && (cpu & SB_CPU_BMI2)) {
+    sha256_process_many_kernel = sha256_process_many_avx2;
+    sha256_many_kernel = sha256_many_x8;
+    sha256_pbkdf2_kernel = sha256_pbkdf2_x8;
+    sha256_pbkdf2_width = 8;
+    return "avx2";
+  }
+#endif
+  if (cpu & SB_CPU_SSSE3) {
+    sha256_process_many_kernel = sha256_process_many_ssse3;
+    return "ssse3";
+  }
+#endif
+  return "portable";
+  
 }
 
 // secretbase - internals ------------------------------------------------------
 
-static inline void hash_bytes(R_outpstream_t stream, void *src, int len) {
+static void hash_bytes(void *ctx, const unsigned char *buf, size_t len) {
   
-  secretbase_context *sctx = (secretbase_context *) stream->data;
-  sctx->skip ? (void) sctx->skip-- :
-    mbedtls_sha256_update((mbedtls_sha256_context *) sctx->ctx, (uint8_t *) src, (size_t) len);
+  mbedtls_sha256_update((mbedtls_sha256_context *) ctx, buf, len);
   
 }
 
@@ -297,28 +999,100 @@ static void hash_object(mbedtls_sha256_context *ctx, const SEXP x) {
     break;
   case RAWSXP:
     if (NO_ATTRIB(x)) {
-      mbedtls_sha256_update(ctx, (uint8_t *) DATAPTR_RO(x), (size_t) XLENGTH(x));
+      sb_hash_raw(x, ctx, hash_bytes);
+      return;
+    }
+    break;
+  }
+  
+  sb_hash_serial(x, ctx, hash_bytes);
+  
+}
+
+static void sha256_hmac_pads(mbedtls_sha256_context *ictx,
+                             mbedtls_sha256_context *octx, const unsigned char *sum) {
+  
+  unsigned char ipad[SB_SHA256_BLK], opad[SB_SHA256_BLK];
+  
+  memset(ipad, 0x36, SB_SHA256_BLK);
+  memset(opad, 0x5C, SB_SHA256_BLK);
+  
+  mbedtls_xor(ipad, ipad, sum, SB_SHA256_BLK);
+  mbedtls_xor(opad, opad, sum, SB_SHA256_BLK);
+  
+  mbedtls_sha256_init(ictx);
+  mbedtls_sha256_starts(ictx);
+  mbedtls_sha256_update(ictx, ipad, SB_SHA256_BLK);
+  mbedtls_sha256_init(octx);
+  mbedtls_sha256_starts(octx);
+  mbedtls_sha256_update(octx, opad, SB_SHA256_BLK);
+  
+  sb_clear_buffer(ipad, SB_SHA256_BLK);
+  sb_clear_buffer(opad, SB_SHA256_BLK);
+  
+}
+
+/*
+ *  A precomputed HMAC key holds the contexts after absorbing the inner and
+ *  outer pad blocks, so that each message signed with it costs only the
+ *  compressions of the message and of the outer digest.
+ */
+
+typedef struct sha256_hmac_key {
+  mbedtls_sha256_context ictx;
+  mbedtls_sha256_context octx;
+} sha256_hmac_key;
+
+static void hmac_key_finalizer(SEXP xptr) {
+  
+  sha256_hmac_key *k = (sha256_hmac_key *) R_ExternalPtrAddr(xptr);
+  if (k == NULL) return;
+  sb_clear_buffer(k, sizeof(sha256_hmac_key));
+  free(k);
+  R_ClearExternalPtr(xptr);
+  
+}
+
+static void sb_sha256_hmac_init(mbedtls_sha256_context *ictx,
+                                mbedtls_sha256_context *octx, const SEXP key) {
+  
+  size_t klen;
+  unsigned char sum[SB_SHA256_BLK];
+  memset(sum, 0, SB_SHA256_BLK);
+  unsigned char *data;
+  
+  switch (TYPEOF(key)) {
+  case EXTPTRSXP:
+    if (Rf_inherits(key, "secretbase_hmackey") && R_ExternalPtrAddr(key) != NULL) {
+      const sha256_hmac_key *k = (const sha256_hmac_key *) R_ExternalPtrAddr(key);
+      *ictx = k->ictx;
+      *octx = k->octx;
       return;
     }
+    Rf_error("'key' is not a valid HMAC key");
+  case STRSXP:
+    data = (unsigned char *) (XLENGTH(key) ? CHAR(*STRING_PTR_RO(key)) : "");
+    klen = strlen((char *) data);
     break;
+  case RAWSXP:
+    data = (unsigned char *) DATAPTR_RO(key);
+    klen = XLENGTH(key);
+    break;
+  default:
+    Rf_error("'key' must be a character string, raw vector or NULL");
   }
   
-  secretbase_context sctx;
-  sctx.skip = SB_SERIAL_HEADERS;
-  sctx.ctx = ctx;
+  if (klen > SB_SHA256_BLK) {
+    mbedtls_sha256_init(ictx);
+    mbedtls_sha256_starts(ictx);
+    hash_object(ictx, key);
+    mbedtls_sha256_finish(ictx, sum);
+  } else {
+    memcpy(sum, data, klen);
+  }
   
-  struct R_outpstream_st output_stream;
-  R_InitOutPStream(
-    &output_stream,
-    (R_pstream_data_t) &sctx,
-    R_pstream_xdr_format,
-    SB_R_SERIAL_VER,
-    NULL,
-    hash_bytes,
-    NULL,
-    R_NilValue
-  );
-  R_Serialize(x, &output_stream);
+  sha256_hmac_pads(ictx, octx, sum);
+  sb_clear_buffer(sum, SB_SHA256_BLK);
   
 }
 
@@ -328,67 +1102,226 @@ static SEXP secretbase_sha256_impl(const SEXP x, const SEXP key, const SEXP conv
   SB_ASSERT_LOGICAL(convert);
   const int conv = SB_LOGICAL(convert);
   unsigned char buf[SB_SHA256_SIZE];
+  mbedtls_sha256_context ctx;
   
   if (key == R_NilValue) {
     
-    mbedtls_sha256_context ctx;
     mbedtls_sha256_init(&ctx);
     mbedtls_sha256_starts(&ctx);
     hash_func(&ctx, x);
     mbedtls_sha256_finish(&ctx, buf);
-    sb_clear_buffer(&ctx, sizeof(mbedtls_sha256_context));
     
   } else {
     
-    size_t klen;
-    unsigned char sum[SB_SHA256_BLK], ipad[SB_SHA256_BLK], opad[SB_SHA256_BLK];
-    mbedtls_sha256_context ctx;
-    memset(sum, 0, SB_SHA256_BLK);
-    unsigned char *data;
+    mbedtls_sha256_context octx;
+    sb_sha256_hmac_init(&ctx, &octx, key);
+    hash_func(&ctx, x);
+    mbedtls_sha256_finish(&ctx, buf);
+    mbedtls_sha256_update(&octx, buf, SB_SHA256_SIZE);
+    mbedtls_sha256_finish(&octx, buf);
+    sb_clear_buffer(&octx, sizeof(mbedtls_sha256_context));
     
-    switch (TYPEOF(key)) {
-    case STRSXP:
-      data = (unsigned char *) (XLENGTH(key) ? CHAR(*STRING_PTR_RO(key)) : "");
-      klen = strlen((char *) data);
-      break;
-    case RAWSXP:
-      data = (unsigned char *) DATAPTR_RO(key);
-      klen = XLENGTH(key);
-      break;
-    default:
-      Rf_error("'key' must be a character string, raw vector or NULL");
+  }
+  
+  sb_clear_buffer(&ctx, sizeof(mbedtls_sha256_context));
+  
+  return sb_hash_sexp(buf, SB_SHA256_SIZE, conv);
+  
+}
+
+static SEXP secretbase_sha256_vec_impl(const SEXP x, const SEXP key, const SEXP convert) {
+  
+  SB_ASSERT_LOGICAL(convert);
+  const int conv = SB_LOGICAL(convert);
+  const R_xlen_t n = XLENGTH(x);
+  mbedtls_sha256_context ictx, octx, ctx;
+  size_t njobs = 0;
+  
+  if (key == R_NilValue) {
+    mbedtls_sha256_init(&ictx);
+    mbedtls_sha256_starts(&ictx);
+  } else {
+    sb_sha256_hmac_init(&ictx, &octx, key);
+  }
+  
+  unsigned char *buf = (unsigned char *) R_alloc(n ? n : 1, SB_SHA256_SIZE);
+  sb_hash_job *jobs = (sb_hash_job *) R_alloc(n ? n : 1, sizeof(sb_hash_job));
+  
+  switch (TYPEOF(x)) {
+  case STRSXP: {
+    const SEXP *p = STRING_PTR_RO(x);
+    for (R_xlen_t i = 0; i < n; i++) {
+      jobs[njobs++] = (sb_hash_job) {
+        (const unsigned char *) CHAR(p[i]), (size_t) LENGTH(p[i]), buf + i * SB_SHA256_SIZE
+      };
     }
-    
-    if (klen > SB_SHA256_BLK) {
-      mbedtls_sha256_init(&ctx);
-      mbedtls_sha256_starts(&ctx);
-      hash_object(&ctx, key);
-      mbedtls_sha256_finish(&ctx, sum);
-    } else {
-      memcpy(sum, data, klen);
+    break;
+  }
+  case VECSXP:
+    for (R_xlen_t i = 0; i < n; i++) {
+      const SEXP el = VECTOR_ELT(x, i);
+      unsigned char *out = buf + i * SB_SHA256_SIZE;
+      if (TYPEOF(el) == STRSXP && XLENGTH(el) == 1 && NO_ATTRIB(el)) {
+        const char *s = CHAR(*STRING_PTR_RO(el));
+        jobs[njobs++] = (sb_hash_job) { (const unsigned char *) s, strlen(s), out };
+      } else if (TYPEOF(el) == RAWSXP && NO_ATTRIB(el)) {
+        jobs[njobs++] = (sb_hash_job) {
+          (const unsigned char *) DATAPTR_RO(el), (size_t) XLENGTH(el), out
+        };
+      } else {
+        ctx = ictx;
+        hash_object(&ctx, el);
+        mbedtls_sha256_finish(&ctx, out);
+      }
     }
-    
-    memset(ipad, 0x36, SB_SHA256_BLK);
-    memset(opad, 0x5C, SB_SHA256_BLK);
-    
-    mbedtls_xor(ipad, ipad, sum, SB_SHA256_BLK);
-    mbedtls_xor(opad, opad, sum, SB_SHA256_BLK);
-    
-    mbedtls_sha256_init(&ctx);
-    mbedtls_sha256_starts(&ctx);
-    mbedtls_sha256_update(&ctx, ipad, SB_SHA256_BLK);
-    hash_func(&ctx, x);
-    mbedtls_sha256_finish(&ctx, buf);
-    mbedtls_sha256_init(&ctx);
-    mbedtls_sha256_starts(&ctx);
-    mbedtls_sha256_update(&ctx, opad, SB_SHA256_BLK);
-    mbedtls_sha256_update(&ctx, buf, SB_SHA256_SIZE);
-    mbedtls_sha256_finish(&ctx, buf);
     sb_clear_buffer(&ctx, sizeof(mbedtls_sha256_context));
+    break;
+  default:
+    sb_clear_buffer(&ictx, sizeof(mbedtls_sha256_context));
+    Rf_error("'x' must be a character vector or list");
+  }
+  
+  sha256_many(&ictx, jobs, njobs);
+  
+  if (key != R_NilValue) {
+    for (R_xlen_t i = 0; i < n; i++) {
+      jobs[i] = (sb_hash_job) {
+        buf + i * SB_SHA256_SIZE, SB_SHA256_SIZE, buf + i * SB_SHA256_SIZE
+      };
+    }
+    sha256_many(&octx, jobs, (size_t) n);
+    sb_clear_buffer(&octx, sizeof(mbedtls_sha256_context));
+  }
+  sb_clear_buffer(&ictx, sizeof(mbedtls_sha256_context));
+  
+  return sb_hash_sexp_vec(buf, SB_SHA256_SIZE, n, conv);
+  
+}
 
+static void sha256_pbkdf2_init(sha256_pbkdf2_lane *lane, const unsigned char *pw,
+                               const size_t pwlen, const unsigned char *salt,
+                               const size_t slen, const size_t nblk,
+                               unsigned char *out, const size_t sz) {
+  
+  mbedtls_sha256_context ictx, octx, ctx;
+  unsigned char sum[SB_SHA256_BLK], ctr[4];
+  memset(sum, 0, SB_SHA256_BLK);
+  
+  if (pwlen > SB_SHA256_BLK) {
+    sb_sha256_raw(pw, pwlen, sum);
+  } else {
+    memcpy(sum, pw, pwlen);
   }
+  sha256_hmac_pads(&ictx, &octx, sum);
   
-  return sb_hash_sexp(buf, SB_SHA256_SIZE, conv);
+  for (size_t b = 0; b < nblk; b++) {
+    ctx = ictx;
+    mbedtls_sha256_update(&ctx, salt, slen);
+    MBEDTLS_PUT_UINT32_BE((uint32_t) (b + 1), ctr, 0);
+    mbedtls_sha256_update(&ctx, ctr, 4);
+    mbedtls_sha256_finish(&ctx, sum);
+    ctx = octx;
+    mbedtls_sha256_update(&ctx, sum, SB_SHA256_SIZE);
+    mbedtls_sha256_finish(&ctx, sum);
+    memcpy(lane[b].ist, ictx.state, sizeof(lane[b].ist));
+    memcpy(lane[b].ost, octx.state, sizeof(lane[b].ost));
+    for (int i = 0; i < 8; i++)
+      lane[b].u[i] = MBEDTLS_GET_UINT32_BE(sum, 4 * i);
+    lane[b].out = out + b * SB_SHA256_SIZE;
+    lane[b].len = sz - b * SB_SHA256_SIZE < SB_SHA256_SIZE ? sz - b * SB_SHA256_SIZE : SB_SHA256_SIZE;
+  }
+  
+  sb_clear_buffer(&ictx, sizeof(mbedtls_sha256_context));
+  sb_clear_buffer(&octx, sizeof(mbedtls_sha256_context));
+  sb_clear_buffer(&ctx, sizeof(mbedtls_sha256_context));
+  sb_clear_buffer(sum, SB_SHA256_BLK);
+  
+}
+
+static SEXP secretbase_pbkdf2_impl(const SEXP password, const SEXP salt, const SEXP iterations,
+                                   const SEXP bits, const SEXP convert) {
+  
+  SB_ASSERT_LOGICAL(convert);
+  const int conv = SB_LOGICAL(convert);
+  const int bt = sb_integer(bits);
+  if (bt < 8 || bt > (1 << 24))
+    Rf_error("'bits' outside valid range of 8 to 2^24");
+  const int iter = sb_integer(iterations);
+  if (iter < 1)
+    Rf_error("'iterations' must be a positive integer");
+  
+  const unsigned char *sdata;
+  size_t slen;
+  switch (TYPEOF(salt)) {
+  case STRSXP:
+    sdata = (const unsigned char *) (XLENGTH(salt) ? CHAR(*STRING_PTR_RO(salt)) : "");
+    slen = strlen((const char *) sdata);
+    break;
+  case RAWSXP:
+    sdata = (const unsigned char *) DATAPTR_RO(salt);
+    slen = (size_t) XLENGTH(salt);
+    break;
+  default:
+    Rf_error("'salt' must be a character string or raw vector");
+  }
+  
+  R_xlen_t n;
+  int vec;
+  switch (TYPEOF(password)) {
+  case STRSXP:
+    n = XLENGTH(password);
+    vec = n != 1;
+    break;
+  case VECSXP:
+    n = XLENGTH(password);
+    vec = 1;
+    for (R_xlen_t i = 0; i < n; i++) {
+      const SEXP el = VECTOR_ELT(password, i);
+      if (!(TYPEOF(el) == STRSXP && XLENGTH(el) == 1) && TYPEOF(el) != RAWSXP)
+        Rf_error("'password' must be a character vector, raw vector or list of these");
+    }
+    break;
+  case RAWSXP:
+    n = 1;
+    vec = 0;
+    break;
+  default:
+    Rf_error("'password' must be a character vector, raw vector or list of these");
+  }
+  
+  const size_t sz = (size_t) (bt / 8);
+  const size_t nblk = (sz + SB_SHA256_SIZE - 1) / SB_SHA256_SIZE;
+  const size_t nlane = (size_t) n * nblk;
+  unsigned char *buf = (unsigned char *) R_alloc(n ? n : 1, sz);
+  sha256_pbkdf2_lane *lane = (sha256_pbkdf2_lane *) R_alloc(nlane ? nlane : 1, sizeof(sha256_pbkdf2_lane));
+  
+  for (R_xlen_t i = 0; i < n; i++) {
+    const unsigned char *pw;
+    size_t pwlen;
+    SEXP el = password;
+    if (TYPEOF(password) == STRSXP) {
+      pw = (const unsigned char *) CHAR(STRING_ELT(password, i));
+      pwlen = strlen((const char *) pw);
+    } else {
+      if (TYPEOF(password) == VECSXP)
+        el = VECTOR_ELT(password, i);
+      if (TYPEOF(el) == STRSXP) {
+        pw = (const unsigned char *) CHAR(*STRING_PTR_RO(el));
+        pwlen = strlen((const char *) pw);
+      } else {
+        pw = (const unsigned char *) DATAPTR_RO(el);
+        pwlen = (size_t) XLENGTH(el);
+      }
+    }
+    sha256_pbkdf2_init(lane + i * nblk, pw, pwlen, sdata, slen, nblk, buf + i * sz, sz);
+  }
+  
+  sha256_pbkdf2_task task = {lane, nlane, sha256_pbkdf2_width, iter};
+  if (nlane)
+    sb_parallel(sha256_pbkdf2_task_run, &task, (nlane + task.width - 1) / task.width);
+  sb_clear_buffer(lane, (nlane ? nlane : 1) * sizeof(sha256_pbkdf2_lane));
+  
+  return vec ? sb_hash_sexp_vec(buf, sz, n, conv) : sb_hash_sexp(buf, sz, conv);
   
 }
 
@@ -404,6 +1337,64 @@ void sb_sha256_raw(const void *data, size_t len, void *digest) {
 
 }
 
+// secretbase - hashing contexts -----------------------------------------------
+
+typedef struct sha256_hash_ctx {
+  mbedtls_sha256_context ictx;
+  mbedtls_sha256_context octx;
+  int hmac;
+} sha256_hash_ctx;
+
+static const char * sha256_ctx_init(void *ctx, const SEXP bits, const SEXP key, size_t *size) {
+  
+  (void) bits;
+  sha256_hash_ctx *h = (sha256_hash_ctx *) ctx;
+  h->hmac = key != R_NilValue;
+  if (h->hmac) {
+    sb_sha256_hmac_init(&h->ictx, &h->octx, key);
+  } else {
+    mbedtls_sha256_init(&h->ictx);
+    mbedtls_sha256_starts(&h->ictx);
+  }
+  *size = SB_SHA256_SIZE;
+  
+  return h->hmac ? "HMAC-SHA-256" : "SHA-256";
+  
+}
+
+static void sha256_ctx_update(void *ctx, const unsigned char *buf, size_t len) {
+  
+  mbedtls_sha256_update(&((sha256_hash_ctx *) ctx)->ictx, buf, len);
+  
+}
+
+static void sha256_ctx_digest(const void *ctx, unsigned char *out) {
+  
+  const sha256_hash_ctx *h = (const sha256_hash_ctx *) ctx;
+  mbedtls_sha256_context c = h->ictx;
+  mbedtls_sha256_finish(&c, out);
+  if (h->hmac) {
+    c = h->octx;
+    mbedtls_sha256_update(&c, out, SB_SHA256_SIZE);
+    mbedtls_sha256_finish(&c, out);
+  }
+  sb_clear_buffer(&c, sizeof(mbedtls_sha256_context));
+  
+}
+
+static int sha256_ctx_check(const void *ctx, size_t size) {
+  
+  const int hmac = ((const sha256_hash_ctx *) ctx)->hmac;
+  
+  return size == SB_SHA256_SIZE && (hmac == 0 || hmac == 1);
+  
+}
+
+const sb_hash_ops sb_sha256_ops = {
+  sizeof(sha256_hash_ctx), sha256_ctx_init, sha256_ctx_update, sha256_ctx_digest,
+  sha256_ctx_check
+};
+
 // secretbase - exported functions ---------------------------------------------
 
 SEXP secretbase_sha256(SEXP x, SEXP key, SEXP convert) {
@@ -417,3 +1408,36 @@ SEXP secretbase_sha256_file(SEXP x, SEXP key, SEXP convert) {
   return secretbase_sha256_impl(x, key, convert, hash_file);
   
 }
+
+SEXP secretbase_sha256_vec(SEXP x, SEXP key, SEXP convert) {
+  
+  return secretbase_sha256_vec_impl(x, key, convert);
+  
+}
+
+SEXP secretbase_hmac_key(SEXP key) {
+  
+  if (TYPEOF(key) != STRSXP && TYPEOF(key) != RAWSXP)
+    Rf_error("'key' must be a character string or raw vector");
+  
+  sha256_hmac_key *k = calloc(1, sizeof(sha256_hmac_key));
+  if (k == NULL)
+    Rf_error("memory allocation failed");
+  
+  SEXP xptr, klass;
+  PROTECT(xptr = R_MakeExternalPtr(k, R_NilValue, R_NilValue));
+  R_RegisterCFinalizerEx(xptr, hmac_key_finalizer, TRUE);
+  klass = Rf_mkString("secretbase_hmackey");
+  Rf_classgets(xptr, klass);
+  sb_sha256_hmac_init(&k->ictx, &k->octx, key);
+  
+  UNPROTECT(1);
+  return xptr;
+  
+}
+
+SEXP secretbase_pbkdf2(SEXP password, SEXP salt, SEXP iterations, SEXP bits, SEXP convert) {
+  
+  return secretbase_pbkdf2_impl(password, salt, iterations, bits, convert);
+  
+}
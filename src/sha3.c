@@ -14,6 +14,16 @@
  *  The SHA-3 Secure Hash Standard was published by NIST in 2015.
  *
  *  https://nvlpubs.nist.gov/nistpubs/fips/nist.fips.202.pdf
+ *
+ *  TurboSHAKE and KangarooTwelve use the same sponge with the permutation
+ *  reduced to its last 12 rounds (Keccak-p[1600, 12]), as specified in
+ *  RFC 9861.
+ *
+ *  https://www.rfc-editor.org/rfc/rfc9861
+ *
+ *  cSHAKE256 and ParallelHash256 are specified in NIST SP 800-185.
+ *
+ *  https://doi.org/10.6028/NIST.SP.800-185
  */
 
 typedef enum {
@@ -21,7 +31,12 @@ typedef enum {
   MBEDTLS_SHA3_224,
   MBEDTLS_SHA3_256,
   MBEDTLS_SHA3_384,
-  MBEDTLS_SHA3_512
+  MBEDTLS_SHA3_512,
+  SB_TURBOSHAKE128 = 9,
+  SB_TURBOSHAKE256,
+  SB_K12_LEAF,
+  SB_PH256_LEAF,
+  SB_SHAKE128
 } mbedtls_sha3_id;
 
 typedef struct mbedtls_sha3_family_functions {
@@ -29,18 +44,24 @@ typedef struct mbedtls_sha3_family_functions {
   uint16_t r;
   uint16_t olen;
   uint8_t xor_byte;
+  uint8_t rounds;
 } mbedtls_sha3_family_functions;
 
 static mbedtls_sha3_family_functions sha3_families[] = {
-  { MBEDTLS_SHA3_SHAKE256, 1088,   0, 0x1F },
-  { MBEDTLS_SHA3_224,      1152, 224, 0x06 },
-  { MBEDTLS_SHA3_256,      1088, 256, 0x06 },
-  { MBEDTLS_SHA3_384,       832, 384, 0x06 },
-  { MBEDTLS_SHA3_512,       576, 512, 0x06 },
-  { MBEDTLS_SHA3_224,      1152, 224, 0x01 },
-  { MBEDTLS_SHA3_256,      1088, 256, 0x01 },
-  { MBEDTLS_SHA3_384,       832, 384, 0x01 },
-  { MBEDTLS_SHA3_512,       576, 512, 0x01 }
+  { MBEDTLS_SHA3_SHAKE256, 1088,   0, 0x1F, 24 },
+  { MBEDTLS_SHA3_224,      1152, 224, 0x06, 24 },
+  { MBEDTLS_SHA3_256,      1088, 256, 0x06, 24 },
+  { MBEDTLS_SHA3_384,       832, 384, 0x06, 24 },
+  { MBEDTLS_SHA3_512,       576, 512, 0x06, 24 },
+  { MBEDTLS_SHA3_224,      1152, 224, 0x01, 24 },
+  { MBEDTLS_SHA3_256,      1088, 256, 0x01, 24 },
+  { MBEDTLS_SHA3_384,       832, 384, 0x01, 24 },
+  { MBEDTLS_SHA3_512,       576, 512, 0x01, 24 },
+  { SB_TURBOSHAKE128,      1344,   0, 0x1F, 12 },
+  { SB_TURBOSHAKE256,      1088,   0, 0x1F, 12 },
+  { SB_K12_LEAF,           1344, 256, 0x0B, 12 },
+  { SB_PH256_LEAF,         1088, 512, 0x1F, 24 },
+  { SB_SHAKE128,           1344,   0, 0x1F, 24 }
 };
 
 static const uint64_t rc[24] = {
@@ -52,6 +73,12 @@ static const uint64_t rc[24] = {
   0x8000000080008081, 0x8000000000008080, 0x0000000080000001, 0x8000000080008008,
 };
 
+#define ROT64( x , y ) ( ( ( x ) << ( y ) ) | ( ( x ) >> ( 64U - ( y ) ) ) )
+#define ABSORB( ctx, idx, v ) do { ctx->state[( idx ) >> 3] ^= ( ( uint64_t ) ( v ) ) << ( ( ( idx ) & 0x7 ) << 3 ); } while ( 0 )
+#define SQUEEZE( ctx, idx ) ( ( uint8_t )( ctx->state[( idx ) >> 3] >> ( ( ( idx ) & 0x7 ) << 3 ) ) )
+
+#if defined(SB_KECCAK_REFERENCE)
+
 static const uint8_t rho[24] = {
   1, 62, 28, 27, 36, 44,  6, 55, 20,
   3, 10, 43, 25, 39, 41, 45, 15,
@@ -63,9 +90,6 @@ static const uint8_t pi[24] = {
   15, 23, 19, 13, 12, 2, 20, 14, 22,  9,  6, 1,
 };
 
-#define ROT64( x , y ) ( ( ( x ) << ( y ) ) | ( ( x ) >> ( 64U - ( y ) ) ) )
-#define ABSORB( ctx, idx, v ) do { ctx->state[( idx ) >> 3] ^= ( ( uint64_t ) ( v ) ) << ( ( ( idx ) & 0x7 ) << 3 ); } while ( 0 )
-#define SQUEEZE( ctx, idx ) ( ( uint8_t )( ctx->state[( idx ) >> 3] >> ( ( ( idx ) & 0x7 ) << 3 ) ) )
 #define SWAP( x, y ) do { uint64_t tmp = ( x ); ( x ) = ( y ); ( y ) = tmp; } while ( 0 )
 
 static void keccak_f1600(mbedtls_sha3_context *ctx) {
@@ -74,7 +98,7 @@ static void keccak_f1600(mbedtls_sha3_context *ctx) {
   uint64_t *s = ctx->state;
   int i;
   
-  for (int round = 0; round < 24; round++) {
+  for (int round = 24 - ctx->rounds; round < 24; round++) {
     
     uint64_t t;
     
@@ -151,6 +175,116 @@ static void keccak_f1600(mbedtls_sha3_context *ctx) {
   
 }
 
+#else
+
+/*
+ *  Keccak-f[1600] with the round function fully unrolled over the 25 lanes,
+ *  held in local variables so that they may be kept in registers. Rho and pi
+ *  are folded into compile-time rotation constants and lane names, and the
+ *  lane complementing transform (from the Keccak team's 'Keccak
+ *  implementation overview') reduces the NOT operations in chi from 25 to 5
+ *  per round. Lanes 1, 2, 8, 12, 17 and 20 are kept complemented for the
+ *  duration of the permutation only, so the state in the context is always
+ *  the canonical one.
+ *
+ *  Define SB_KECCAK_REFERENCE at build time to instead use the compact
+ *  table-driven reference implementation.
+ */
+
+#define KECCAK_ROUND(A, E, i) \
+  Ca = A##ba^A##ga^A##ka^A##ma^A##sa; \
+  Ce = A##be^A##ge^A##ke^A##me^A##se; \
+  Ci = A##bi^A##gi^A##ki^A##mi^A##si; \
+  Co = A##bo^A##go^A##ko^A##mo^A##so; \
+  Cu = A##bu^A##gu^A##ku^A##mu^A##su; \
+  Da = Cu^ROT64(Ce, 1); \
+  De = Ca^ROT64(Ci, 1); \
+  Di = Ce^ROT64(Co, 1); \
+  Do = Ci^ROT64(Cu, 1); \
+  Du = Co^ROT64(Ca, 1); \
+  Bba = A##ba^Da; \
+  Bbe = ROT64(A##ge^De, 44); \
+  Bbi = ROT64(A##ki^Di, 43); \
+  Bbo = ROT64(A##mo^Do, 21); \
+  Bbu = ROT64(A##su^Du, 14); \
+  E##ba = Bba ^ (Bbe | Bbi) ^ rc[(i)]; \
+  E##be = Bbe ^ ((~Bbi) | Bbo); \
+  E##bi = Bbi ^ (Bbo & Bbu); \
+  E##bo = Bbo ^ (Bbu | Bba); \
+  E##bu = Bbu ^ (Bba & Bbe); \
+  Bga = ROT64(A##bo^Do, 28); \
+  Bge = ROT64(A##gu^Du, 20); \
+  Bgi = ROT64(A##ka^Da, 3); \
+  Bgo = ROT64(A##me^De, 45); \
+  Bgu = ROT64(A##si^Di, 61); \
+  E##ga = Bga ^ (Bge | Bgi); \
+  E##ge = Bge ^ (Bgi & Bgo); \
+  E##gi = Bgi ^ (Bgo | (~Bgu)); \
+  E##go = Bgo ^ (Bgu | Bga); \
+  E##gu = Bgu ^ (Bga & Bge); \
+  Bka = ROT64(A##be^De, 1); \
+  Bke = ROT64(A##gi^Di, 6); \
+  Bki = ROT64(A##ko^Do, 25); \
+  Bko = ROT64(A##mu^Du, 8); \
+  Bku = ROT64(A##sa^Da, 18); \
+  E##ka = Bka ^ (Bke | Bki); \
+  E##ke = Bke ^ (Bki & Bko); \
+  E##ki = Bki ^ ((~Bko) & Bku); \
+  E##ko = (~Bko) ^ (Bku | Bka); \
+  E##ku = Bku ^ (Bka & Bke); \
+  Bma = ROT64(A##bu^Du, 27); \
+  Bme = ROT64(A##ga^Da, 36); \
+  Bmi = ROT64(A##ke^De, 10); \
+  Bmo = ROT64(A##mi^Di, 15); \
+  Bmu = ROT64(A##so^Do, 56); \
+  E##ma = Bma ^ (Bme & Bmi); \
+  E##me = Bme ^ (Bmi | Bmo); \
+  E##mi = Bmi ^ ((~Bmo) | Bmu); \
+  E##mo = (~Bmo) ^ (Bmu & Bma); \
+  E##mu = Bmu ^ (Bma | Bme); \
+  Bsa = ROT64(A##bi^Di, 62); \
+  Bse = ROT64(A##go^Do, 55); \
+  Bsi = ROT64(A##ku^Du, 39); \
+  Bso = ROT64(A##ma^Da, 41); \
+  Bsu = ROT64(A##se^De, 2); \
+  E##sa = Bsa ^ ((~Bse) & Bsi); \
+  E##se = (~Bse) ^ (Bsi | Bso); \
+  E##si = Bsi ^ (Bso & Bsu); \
+  E##so = Bso ^ (Bsu | Bsa); \
+  E##su = Bsu ^ (Bsa & Bse);
+
+static void keccak_f1600(mbedtls_sha3_context *ctx) {
+
+  uint64_t *s = ctx->state;
+  uint64_t Aba, Abe, Abi, Abo, Abu, Aga, Age, Agi, Ago, Agu, Aka, Ake, Aki,
+           Ako, Aku, Ama, Ame, Ami, Amo, Amu, Asa, Ase, Asi, Aso, Asu;
+  uint64_t Bba, Bbe, Bbi, Bbo, Bbu, Bga, Bge, Bgi, Bgo, Bgu, Bka, Bke, Bki,
+           Bko, Bku, Bma, Bme, Bmi, Bmo, Bmu, Bsa, Bse, Bsi, Bso, Bsu;
+  uint64_t Eba, Ebe, Ebi, Ebo, Ebu, Ega, Ege, Egi, Ego, Egu, Eka, Eke, Eki,
+           Eko, Eku, Ema, Eme, Emi, Emo, Emu, Esa, Ese, Esi, Eso, Esu;
+  uint64_t Ca, Ce, Ci, Co, Cu, Da, De, Di, Do, Du;
+
+  Aba = s[0]; Abe = ~s[1]; Abi = ~s[2]; Abo = s[3]; Abu = s[4];
+  Aga = s[5]; Age = s[6]; Agi = s[7]; Ago = ~s[8]; Agu = s[9];
+  Aka = s[10]; Ake = s[11]; Aki = ~s[12]; Ako = s[13]; Aku = s[14];
+  Ama = s[15]; Ame = s[16]; Ami = ~s[17]; Amo = s[18]; Amu = s[19];
+  Asa = ~s[20]; Ase = s[21]; Asi = s[22]; Aso = s[23]; Asu = s[24];
+
+  for (int round = 24 - ctx->rounds; round < 24; round += 2) {
+    KECCAK_ROUND(A, E, round);
+    KECCAK_ROUND(E, A, round + 1);
+  }
+
+  s[0] = Aba; s[1] = ~Abe; s[2] = ~Abi; s[3] = Abo; s[4] = Abu;
+  s[5] = Aga; s[6] = Age; s[7] = Agi; s[8] = ~Ago; s[9] = Agu;
+  s[10] = Aka; s[11] = Ake; s[12] = ~Aki; s[13] = Ako; s[14] = Aku;
+  s[15] = Ama; s[16] = Ame; s[17] = ~Ami; s[18] = Amo; s[19] = Amu;
+  s[20] = ~Asa; s[21] = Ase; s[22] = Asi; s[23] = Aso; s[24] = Asu;
+
+}
+
+#endif
+
 static void mbedtls_sha3_init(mbedtls_sha3_context *ctx) {
 
   memset(ctx, 0, sizeof(mbedtls_sha3_context));
@@ -165,20 +299,91 @@ static void mbedtls_sha3_starts(mbedtls_sha3_context *ctx, mbedtls_sha3_id id) {
   ctx->olen = p.olen / 8;
   ctx->xor_byte = p.xor_byte;
   ctx->max_block_size = ctx->r / 8;
+  ctx->rounds = p.rounds;
   
 }
 
+/* XORs len bytes into the state starting at byte idx, which must not cross the
+ * end of the rate block: single bytes up to a lane boundary, whole 64-bit
+ * little-endian lanes, then any trailing bytes */
+static inline void keccak_absorb(mbedtls_sha3_context *ctx, size_t idx,
+                                 const uint8_t *input, size_t len) {
+
+  for (; len && (idx & 0x7); idx++, len--)
+    ABSORB(ctx, idx, *input++);
+
+  for (; len >= 8; idx += 8, len -= 8, input += 8)
+    ctx->state[idx >> 3] ^= MBEDTLS_GET_UINT64_LE(input, 0);
+
+  for (; len; idx++, len--)
+    ABSORB(ctx, idx, *input++);
+
+}
+
+static inline void keccak_squeeze(mbedtls_sha3_context *ctx, size_t idx,
+                                  uint8_t *output, size_t len) {
+
+  for (; len && (idx & 0x7); idx++, len--)
+    *output++ = SQUEEZE(ctx, idx);
+
+  for (; len >= 8; idx += 8, len -= 8, output += 8)
+    MBEDTLS_PUT_UINT64_LE(ctx->state[idx >> 3], output, 0);
+
+  for (; len; idx++, len--)
+    *output++ = SQUEEZE(ctx, idx);
+
+}
+
 static void mbedtls_sha3_update(mbedtls_sha3_context *ctx, const uint8_t *input, size_t ilen) {
-  
+
   if (ilen == 0 || input == NULL)
     return;
-  
-  while (ilen-- > 0) {
-    ABSORB(ctx, ctx->index, *input++);
-    if ((ctx->index = (ctx->index + 1) % ctx->max_block_size) == 0)
+
+  const size_t bs = ctx->max_block_size;
+  size_t idx = ctx->index;
+
+  if (idx) {
+    size_t fill = bs - idx;
+    if (ilen < fill) {
+      keccak_absorb(ctx, idx, input, ilen);
+      ctx->index = (uint8_t) (idx + ilen);
+      return;
+    }
+    keccak_absorb(ctx, idx, input, fill);
+    keccak_f1600(ctx);
+    input += fill;
+    ilen -= fill;
+  }
+
+  while (ilen >= bs) {
+    keccak_absorb(ctx, 0, input, bs);
+    keccak_f1600(ctx);
+    input += bs;
+    ilen -= bs;
+  }
+
+  keccak_absorb(ctx, 0, input, ilen);
+  ctx->index = (uint8_t) ilen;
+
+}
+
+static void mbedtls_sha3_squeeze(mbedtls_sha3_context *ctx, uint8_t *output, size_t olen) {
+
+  const size_t bs = ctx->max_block_size;
+  size_t idx = ctx->index;
+
+  while (olen > 0) {
+    size_t n = bs - idx < olen ? bs - idx : olen;
+    keccak_squeeze(ctx, idx, output, n);
+    output += n;
+    olen -= n;
+    if ((idx += n) == bs) {
       keccak_f1600(ctx);
+      idx = 0;
+    }
   }
-  
+  ctx->index = (uint8_t) idx;
+
 }
 
 static void mbedtls_sha3_finish(mbedtls_sha3_context *ctx, uint8_t *output, size_t olen) {
@@ -187,200 +392,1909 @@ static void mbedtls_sha3_finish(mbedtls_sha3_context *ctx, uint8_t *output, size
   ABSORB(ctx, ctx->max_block_size - 1, 0x80);
   keccak_f1600(ctx);
   ctx->index = 0;
-  
-  while (olen-- > 0) {
-    *output++ = SQUEEZE(ctx, ctx->index);
-    if ((ctx->index = (ctx->index + 1) % ctx->max_block_size) == 0)
-      keccak_f1600(ctx);
-  }
-  
-}
 
-// secretbase - internals ------------------------------------------------------
+  mbedtls_sha3_squeeze(ctx, output, olen);
 
-static inline int sb_integer(SEXP x) {
-  return (TYPEOF(x) == INTSXP || TYPEOF(x) == LGLSXP) ? SB_LOGICAL(x) : Rf_asInteger(x); 
 }
 
-#if !defined(MBEDTLS_CT_ASM)
-static void * (*const volatile secure_memset)(void *, int, size_t) = memset;
-#endif
+// secretbase - multi-buffer sha3 ----------------------------------------------
+
+/*
+ *  Hashes a batch of independent messages. Where AVX2 is available, 4 sponges
+ *  are permuted at once by a 4-way Keccak-f[1600] holding one 64-bit lane of
+ *  each state in a 256-bit register, using AVX-512VL rotates and ternary
+ *  logic where also available. Each sponge lane is refilled with the next
+ *  message as soon as its current one is squeezed, so messages of differing
+ *  lengths keep all 4 lanes busy. The same kernels hash KangarooTwelve leaves,
+ *  starting the permutation at round 12.
+ */
+
+static void sha3_many_scalar(const sb_hash_job *jobs, const size_t n,
+                             const mbedtls_sha3_id id) {
+
+  mbedtls_sha3_context ctx;
+  for (size_t i = 0; i < n; i++) {
+    mbedtls_sha3_init(&ctx);
+    mbedtls_sha3_starts(&ctx, id);
+    mbedtls_sha3_update(&ctx, jobs[i].buf, jobs[i].len);
+    mbedtls_sha3_finish(&ctx, jobs[i].out, ctx.olen);
+  }
+  sb_clear_buffer(&ctx, sizeof(mbedtls_sha3_context));
 
-inline void sb_clear_buffer(void *buf, const size_t sz) {
-#ifdef MBEDTLS_CT_ASM
-  memset(buf, 0, sz);
-  asm volatile ("" ::: "memory");
-#else
-  secure_memset(buf, 0, sz);
-#endif
 }
 
-static inline void hash_bytes(R_outpstream_t stream, void *src, int len) {
-  
-  secretbase_context *sctx = (secretbase_context *) stream->data;
-  sctx->skip ? (void) sctx->skip-- :
-    mbedtls_sha3_update((mbedtls_sha3_context *) sctx->ctx, (uint8_t *) src, (size_t) len);
-  
+#ifdef SB_X86_AVX2
+
+#include <immintrin.h>
+
+#define XOR256(a, b) _mm256_xor_si256((a), (b))
+
+#define KECCAK4_ROUND(A, E, i) \
+  Ca = XOR5(A##ba, A##ga, A##ka, A##ma, A##sa); \
+  Ce = XOR5(A##be, A##ge, A##ke, A##me, A##se); \
+  Ci = XOR5(A##bi, A##gi, A##ki, A##mi, A##si); \
+  Co = XOR5(A##bo, A##go, A##ko, A##mo, A##so); \
+  Cu = XOR5(A##bu, A##gu, A##ku, A##mu, A##su); \
+  Da = XOR256(Cu, ROL256(Ce, 1)); \
+  De = XOR256(Ca, ROL256(Ci, 1)); \
+  Di = XOR256(Ce, ROL256(Co, 1)); \
+  Do = XOR256(Ci, ROL256(Cu, 1)); \
+  Du = XOR256(Co, ROL256(Ca, 1)); \
+  Bba = XOR256(A##ba, Da); \
+  Bbe = ROL256(XOR256(A##ge, De), 44); \
+  Bbi = ROL256(XOR256(A##ki, Di), 43); \
+  Bbo = ROL256(XOR256(A##mo, Do), 21); \
+  Bbu = ROL256(XOR256(A##su, Du), 14); \
+  E##ba = XOR256(ANDNXOR(Bba, Bbe, Bbi), _mm256_set1_epi64x((long long) rc[(i)])); \
+  E##be = ANDNXOR(Bbe, Bbi, Bbo); \
+  E##bi = ANDNXOR(Bbi, Bbo, Bbu); \
+  E##bo = ANDNXOR(Bbo, Bbu, Bba); \
+  E##bu = ANDNXOR(Bbu, Bba, Bbe); \
+  Bga = ROL256(XOR256(A##bo, Do), 28); \
+  Bge = ROL256(XOR256(A##gu, Du), 20); \
+  Bgi = ROL256(XOR256(A##ka, Da), 3); \
+  Bgo = ROL256(XOR256(A##me, De), 45); \
+  Bgu = ROL256(XOR256(A##si, Di), 61); \
+  E##ga = ANDNXOR(Bga, Bge, Bgi); \
+  E##ge = ANDNXOR(Bge, Bgi, Bgo); \
+  E##gi = ANDNXOR(Bgi, Bgo, Bgu); \
+  E##go = ANDNXOR(Bgo, Bgu, Bga); \
+  E##gu = ANDNXOR(Bgu, Bga, Bge); \
+  Bka = ROL256(XOR256(A##be, De), 1); \
+  Bke = ROL256(XOR256(A##gi, Di), 6); \
+  Bki = ROL256(XOR256(A##ko, Do), 25); \
+  Bko = ROL256(XOR256(A##mu, Du), 8); \
+  Bku = ROL256(XOR256(A##sa, Da), 18); \
+  E##ka = ANDNXOR(Bka, Bke, Bki); \
+  E##ke = ANDNXOR(Bke, Bki, Bko); \
+  E##ki = ANDNXOR(Bki, Bko, Bku); \
+  E##ko = ANDNXOR(Bko, Bku, Bka); \
+  E##ku = ANDNXOR(Bku, Bka, Bke); \
+  Bma = ROL256(XOR256(A##bu, Du), 27); \
+  Bme = ROL256(XOR256(A##ga, Da), 36); \
+  Bmi = ROL256(XOR256(A##ke, De), 10); \
+  Bmo = ROL256(XOR256(A##mi, Di), 15); \
+  Bmu = ROL256(XOR256(A##so, Do), 56); \
+  E##ma = ANDNXOR(Bma, Bme, Bmi); \
+  E##me = ANDNXOR(Bme, Bmi, Bmo); \
+  E##mi = ANDNXOR(Bmi, Bmo, Bmu); \
+  E##mo = ANDNXOR(Bmo, Bmu, Bma); \
+  E##mu = ANDNXOR(Bmu, Bma, Bme); \
+  Bsa = ROL256(XOR256(A##bi, Di), 62); \
+  Bse = ROL256(XOR256(A##go, Do), 55); \
+  Bsi = ROL256(XOR256(A##ku, Du), 39); \
+  Bso = ROL256(XOR256(A##ma, Da), 41); \
+  Bsu = ROL256(XOR256(A##se, De), 2); \
+  E##sa = ANDNXOR(Bsa, Bse, Bsi); \
+  E##se = ANDNXOR(Bse, Bsi, Bso); \
+  E##si = ANDNXOR(Bsi, Bso, Bsu); \
+  E##so = ANDNXOR(Bso, Bsu, Bsa); \
+  E##su = ANDNXOR(Bsu, Bsa, Bse);
+
+/* defines a 4-way permutation from the primitives XOR5, ROL256 and ANDNXOR */
+#define KECCAK_F1600_X4(name)                                                 \
+static void name(uint64_t st[25][4], const int start) {                       \
+                                                                              \
+  __m256i Aba, Abe, Abi, Abo, Abu, Aga, Age, Agi, Ago, Agu, Aka, Ake, Aki,    \
+          Ako, Aku, Ama, Ame, Ami, Amo, Amu, Asa, Ase, Asi, Aso, Asu;         \
+  __m256i Bba, Bbe, Bbi, Bbo, Bbu, Bga, Bge, Bgi, Bgo, Bgu, Bka, Bke, Bki,    \
+          Bko, Bku, Bma, Bme, Bmi, Bmo, Bmu, Bsa, Bse, Bsi, Bso, Bsu;         \
+  __m256i Eba, Ebe, Ebi, Ebo, Ebu, Ega, Ege, Egi, Ego, Egu, Eka, Eke, Eki,    \
+          Eko, Eku, Ema, Eme, Emi, Emo, Emu, Esa, Ese, Esi, Eso, Esu;         \
+  __m256i Ca, Ce, Ci, Co, Cu, Da, De, Di, Do, Du;                             \
+                                                                              \
+  Aba = _mm256_loadu_si256((const __m256i *) st[0]);                          \
+  Abe = _mm256_loadu_si256((const __m256i *) st[1]);                          \
+  Abi = _mm256_loadu_si256((const __m256i *) st[2]);                          \
+  Abo = _mm256_loadu_si256((const __m256i *) st[3]);                          \
+  Abu = _mm256_loadu_si256((const __m256i *) st[4]);                          \
+  Aga = _mm256_loadu_si256((const __m256i *) st[5]);                          \
+  Age = _mm256_loadu_si256((const __m256i *) st[6]);                          \
+  Agi = _mm256_loadu_si256((const __m256i *) st[7]);                          \
+  Ago = _mm256_loadu_si256((const __m256i *) st[8]);                          \
+  Agu = _mm256_loadu_si256((const __m256i *) st[9]);                          \
+  Aka = _mm256_loadu_si256((const __m256i *) st[10]);                         \
+  Ake = _mm256_loadu_si256((const __m256i *) st[11]);                         \
+  Aki = _mm256_loadu_si256((const __m256i *) st[12]);                         \
+  Ako = _mm256_loadu_si256((const __m256i *) st[13]);                         \
+  Aku = _mm256_loadu_si256((const __m256i *) st[14]);                         \
+  Ama = _mm256_loadu_si256((const __m256i *) st[15]);                         \
+  Ame = _mm256_loadu_si256((const __m256i *) st[16]);                         \
+  Ami = _mm256_loadu_si256((const __m256i *) st[17]);                         \
+  Amo = _mm256_loadu_si256((const __m256i *) st[18]);                         \
+  Amu = _mm256_loadu_si256((const __m256i *) st[19]);                         \
+  Asa = _mm256_loadu_si256((const __m256i *) st[20]);                         \
+  Ase = _mm256_loadu_si256((const __m256i *) st[21]);                         \
+  Asi = _mm256_loadu_si256((const __m256i *) st[22]);                         \
+  Aso = _mm256_loadu_si256((const __m256i *) st[23]);                         \
+  Asu = _mm256_loadu_si256((const __m256i *) st[24]);                         \
+                                                                              \
+  for (int round = start; round < 24; round += 2) {                           \
+    KECCAK4_ROUND(A, E, round);                                               \
+    KECCAK4_ROUND(E, A, round + 1);                                           \
+  }                                                                           \
+                                                                              \
+  _mm256_storeu_si256((__m256i *) st[0], Aba);                                \
+  _mm256_storeu_si256((__m256i *) st[1], Abe);                                \
+  _mm256_storeu_si256((__m256i *) st[2], Abi);                                \
+  _mm256_storeu_si256((__m256i *) st[3], Abo);                                \
+  _mm256_storeu_si256((__m256i *) st[4], Abu);                                \
+  _mm256_storeu_si256((__m256i *) st[5], Aga);                                \
+  _mm256_storeu_si256((__m256i *) st[6], Age);                                \
+  _mm256_storeu_si256((__m256i *) st[7], Agi);                                \
+  _mm256_storeu_si256((__m256i *) st[8], Ago);                                \
+  _mm256_storeu_si256((__m256i *) st[9], Agu);                                \
+  _mm256_storeu_si256((__m256i *) st[10], Aka);                               \
+  _mm256_storeu_si256((__m256i *) st[11], Ake);                               \
+  _mm256_storeu_si256((__m256i *) st[12], Aki);                               \
+  _mm256_storeu_si256((__m256i *) st[13], Ako);                               \
+  _mm256_storeu_si256((__m256i *) st[14], Aku);                               \
+  _mm256_storeu_si256((__m256i *) st[15], Ama);                               \
+  _mm256_storeu_si256((__m256i *) st[16], Ame);                               \
+  _mm256_storeu_si256((__m256i *) st[17], Ami);                               \
+  _mm256_storeu_si256((__m256i *) st[18], Amo);                               \
+  _mm256_storeu_si256((__m256i *) st[19], Amu);                               \
+  _mm256_storeu_si256((__m256i *) st[20], Asa);                               \
+  _mm256_storeu_si256((__m256i *) st[21], Ase);                               \
+  _mm256_storeu_si256((__m256i *) st[22], Asi);                               \
+  _mm256_storeu_si256((__m256i *) st[23], Aso);                               \
+  _mm256_storeu_si256((__m256i *) st[24], Asu);                               \
+                                                                              \
 }
 
-static void hash_file(mbedtls_sha3_context *ctx, const SEXP x) {
-  
-  SB_ASSERT_STR(x);
-  const char *file = R_ExpandFileName(CHAR(*STRING_PTR_RO(x)));
-  unsigned char buf[SB_BUF_SIZE];
-  FILE *f;
-  size_t cur;
-  
-  if ((f = fopen(file, "rb")) == NULL)
-    ERROR_FOPEN(file);
-  
-  setbuf(f, NULL);
-  
-  while ((cur = fread(buf, sizeof(char), SB_BUF_SIZE, f))) {
-    mbedtls_sha3_update(ctx, buf, cur);
-  }
-  
-  if (ferror(f)) {
-    fclose(f);
-    ERROR_FREAD(file);
-  }
-  fclose(f);
-  
+#define XOR5(a, b, c, d, e) XOR256(XOR256(XOR256((a), (b)), XOR256((c), (d))), (e))
+#define ROL256(x, n) _mm256_or_si256(_mm256_slli_epi64((x), (n)), _mm256_srli_epi64((x), 64 - (n)))
+#define ANDNXOR(a, b, c) XOR256((a), _mm256_andnot_si256((b), (c)))
+
+__attribute__((target("avx2")))
+KECCAK_F1600_X4(keccak_f1600_x4_avx2)
+
+#undef XOR5
+#undef ROL256
+#undef ANDNXOR
+
+/* AVX-512VL: native 64-bit rotates, and 3-input logic for theta and chi */
+#define XOR5(a, b, c, d, e) _mm256_ternarylogic_epi64(_mm256_ternarylogic_epi64((a), (b), (c), 0x96), (d), (e), 0x96)
+#define ROL256(x, n) _mm256_rol_epi64((x), (n))
+#define ANDNXOR(a, b, c) _mm256_ternarylogic_epi64((a), (b), (c), 0xD2)
+
+__attribute__((target("avx2,avx512f,avx512vl")))
+KECCAK_F1600_X4(keccak_f1600_x4_avx512)
+
+#undef XOR5
+#undef ROL256
+#undef ANDNXOR
+
+static void keccak_x4_absorb(uint64_t st[25][4], const int l,
+                             const uint8_t *input, size_t len) {
+
+  size_t idx = 0;
+  for (; len >= 8; idx += 8, len -= 8, input += 8)
+    st[idx >> 3][l] ^= MBEDTLS_GET_UINT64_LE(input, 0);
+
+  for (; len; idx++, len--)
+    st[idx >> 3][l] ^= ((uint64_t) *input++) << ((idx & 0x7) << 3);
+
 }
 
-static void hash_object(mbedtls_sha3_context *ctx, const SEXP x) {
-  
-  switch (TYPEOF(x)) {
-  case STRSXP:
-    if (XLENGTH(x) == 1 && NO_ATTRIB(x)) {
-      const char *s = CHAR(*STRING_PTR_RO(x));
-      mbedtls_sha3_update(ctx, (uint8_t *) s, strlen(s));
-      return;
+static inline void sha3_many_x4(const sb_hash_job *jobs, const size_t n,
+                                const mbedtls_sha3_id id,
+                                void (*const permute)(uint64_t [25][4], int)) {
+
+  const mbedtls_sha3_family_functions p = sha3_families[id];
+  const size_t bs = p.r / 8;
+  const size_t olen = p.olen / 8;
+  uint64_t st[25][4];
+  const sb_hash_job *lane[4] = {NULL, NULL, NULL, NULL};
+  size_t off[4], next = 0;
+  int active = 0, last[4];
+
+  for (;;) {
+
+    for (int l = 0; l < 4; l++) {
+      if (lane[l] == NULL && next < n) {
+        lane[l] = &jobs[next++];
+        off[l] = 0;
+        for (int k = 0; k < 25; k++) st[k][l] = 0;
+        active++;
+      }
     }
-    break;
-  case RAWSXP:
-    if (NO_ATTRIB(x)) {
-      mbedtls_sha3_update(ctx, (uint8_t *) DATAPTR_RO(x), (size_t) XLENGTH(x));
-      return;
+    if (!active)
+      break;
+
+    for (int l = 0; l < 4; l++) {
+      last[l] = 0;
+      if (lane[l] == NULL)
+        continue;
+      const size_t rem = lane[l]->len - off[l];
+      if (rem >= bs) {
+        keccak_x4_absorb(st, l, lane[l]->buf + off[l], bs);
+        off[l] += bs;
+      } else {
+        keccak_x4_absorb(st, l, lane[l]->buf + off[l], rem);
+        st[rem >> 3][l] ^= ((uint64_t) p.xor_byte) << ((rem & 0x7) << 3);
+        st[(bs - 1) >> 3][l] ^= ((uint64_t) 0x80) << (((bs - 1) & 0x7) << 3);
+        last[l] = 1;
+      }
     }
-    break;
-  }
-  
-  secretbase_context sctx;
-  sctx.skip = SB_SERIAL_HEADERS;
-  sctx.ctx = ctx;
-  
-  struct R_outpstream_st output_stream;
-  R_InitOutPStream(
-    &output_stream,
-    (R_pstream_data_t) &sctx,
-    R_pstream_xdr_format,
-    SB_R_SERIAL_VER,
-    NULL,
-    hash_bytes,
-    NULL,
-    R_NilValue
-  );
-  R_Serialize(x, &output_stream);
-  
-}
 
-SEXP sb_hash_sexp(unsigned char *buf, const size_t sz, const int conv) {
+    permute(st, 24 - p.rounds);
 
-  static const char hex[] = "0123456789abcdef";
-  SEXP out;
-  if (conv == 0) {
-    out = Rf_allocVector(RAWSXP, sz);
-    memcpy(SB_DATAPTR(out), buf, sz);
-  } else if (conv == 1) {
-    char cbuf[sz + sz + 1];
-    for (size_t i = 0; i < sz; i++) {
-      cbuf[2 * i]     = hex[buf[i] >> 4];
-      cbuf[2 * i + 1] = hex[buf[i] & 0x0f];
+    for (int l = 0; l < 4; l++) {
+      if (!last[l])
+        continue;
+      unsigned char *out = lane[l]->out;
+      for (size_t i = 0; i < olen; i += 8) {
+        const uint64_t v = st[i >> 3][l];
+        for (size_t j = 0; j < 8 && i + j < olen; j++)
+          out[i + j] = (unsigned char) (v >> (j << 3));
+      }
+      lane[l] = NULL;
+      active--;
     }
-    cbuf[sz + sz] = '\0';
-    PROTECT(out = Rf_allocVector(STRSXP, 1));
-    SET_STRING_ELT(out, 0, Rf_mkCharLenCE(cbuf, (int) (sz + sz), CE_NATIVE));
-    UNPROTECT(1);
-  } else {
-    out = Rf_allocVector(INTSXP, sz / sizeof(int));
-    memcpy(SB_DATAPTR(out), buf, sz);
+
   }
 
-  return out;
+  sb_clear_buffer(st, sizeof(st));
 
 }
 
-static SEXP secretbase_sha3_impl(const SEXP x, const SEXP bits, const SEXP convert,
-                                 void (*const hash_func)(mbedtls_sha3_context *, SEXP),
-                                 const int offset) {
-  
-  SB_ASSERT_LOGICAL(convert);
-  const int conv = SB_LOGICAL(convert);
-  const int bt = sb_integer(bits);
+static void sha3_many_avx2(const sb_hash_job *jobs, const size_t n,
+                           const mbedtls_sha3_id id) {
+
+  sha3_many_x4(jobs, n, id, keccak_f1600_x4_avx2);
+
+}
+
+static void sha3_many_avx512(const sb_hash_job *jobs, const size_t n,
+                             const mbedtls_sha3_id id) {
+
+  sha3_many_x4(jobs, n, id, keccak_f1600_x4_avx512);
+
+}
+
+#endif
+
+static void (*sha3_many_kernel)(const sb_hash_job *, const size_t,
+                                const mbedtls_sha3_id) = sha3_many_scalar;
+
+static void sha3_many(const sb_hash_job *jobs, const size_t n,
+                      const mbedtls_sha3_id id) {
+
+  (n > 1 ? sha3_many_kernel : sha3_many_scalar)(jobs, n, id);
+
+}
+
+const char * sb_sha3_select(const int cpu) {
+
+#ifdef SB_X86_AVX2
+  if (cpu & SB_CPU_AVX512) {
+    sha3_many_kernel = sha3_many_avx512;
+    return "avx512";
+  }
+  if (cpu & SB_CPU_AVX2) {
+    sha3_many_kernel = sha3_many_avx2;
+    return "avx2";
+  }
+#endif
+  sha3_many_kernel = sha3_many_scalar;
+  return "portable";
+
+}
+
+// secretbase - parallel leaf hashing -----------------------------------------
+
+/*
+ *  KangarooTwelve and ParallelHash split their input into fixed-size leaves,
+ *  each hashed independently to a chaining value which is absorbed into a
+ *  final node in order. Complete leaves are hashed in place in batches by the
+ *  multi-buffer kernel, and long runs of leaves are split across threads a
+ *  span at a time, so the chaining values held at once stay bounded.
+ */
+
+#define SB_LEAF_BATCH 64
+#define SB_LEAF_TASK 524288
+#define SB_LEAF_SPAN 33554432
+#define SB_LEAF_PAR_MIN 1048576
+#define SB_LEAF_FILE_BUF 4194304
+
+typedef struct sb_leaf_task {
+  const uint8_t *input;
+  size_t n;
+  size_t len;
+  size_t per;
+  uint8_t *cv;
   mbedtls_sha3_id id;
+} sb_leaf_task;
+
+static void sb_leaf_batch(const uint8_t *input, size_t n, const size_t len,
+                          uint8_t *cv, const mbedtls_sha3_id id) {
   
-  if (offset < 0) {
-    if (bt < 8 || bt > (1 << 24))
-      Rf_error("'bits' outside valid range of 8 to 2^24");
-    id = MBEDTLS_SHA3_SHAKE256;
-  } else {
-    switch(bt) {
-    case 256:
-      id = MBEDTLS_SHA3_256 + offset; break;
-    case 512:
-      id = MBEDTLS_SHA3_512 + offset; break;
-    case 224:
-      id = MBEDTLS_SHA3_224 + offset; break;
-    case 384:
-      id = MBEDTLS_SHA3_384 + offset; break;
-    default:
-      id = MBEDTLS_SHA3_SHAKE256;
-      Rf_error("'bits' must be 224, 256, 384 or 512");
+  const size_t cvsz = sha3_families[id].olen / 8;
+  sb_hash_job jobs[SB_LEAF_BATCH];
+  
+  while (n) {
+    const size_t m = n < SB_LEAF_BATCH ? n : SB_LEAF_BATCH;
+    for (size_t i = 0; i < m; i++) {
+      jobs[i].buf = input + i * len;
+      jobs[i].len = len;
+      jobs[i].out = cv + i * cvsz;
     }
+    sha3_many(jobs, m, id);
+    input += m * len;
+    cv += m * cvsz;
+    n -= m;
   }
   
-  const size_t sz = (size_t) (bt / 8);
-  unsigned char buf[sz];
-  
-  mbedtls_sha3_context ctx;
-  mbedtls_sha3_init(&ctx);
-  mbedtls_sha3_starts(&ctx, id);
-  hash_func(&ctx, x);
-  mbedtls_sha3_finish(&ctx, buf, sz);
-  sb_clear_buffer(&ctx, sizeof(mbedtls_sha3_context));
+}
+
+static void sb_leaf_task_run(void *arg, size_t i) {
   
-  return sb_hash_sexp(buf, sz, conv);
+  const sb_leaf_task *task = (const sb_leaf_task *) arg;
+  const size_t off = i * task->per;
+  const size_t n = task->n - off < task->per ? task->n - off : task->per;
+  sb_leaf_batch(task->input + off * task->len, n, task->len,
+                task->cv + off * (sha3_families[task->id].olen / 8), task->id);
   
 }
 
-// secretbase - exported functions ---------------------------------------------
-
-SEXP secretbase_sha3(SEXP x, SEXP bits, SEXP convert) {
+/* hashes n leaves of len bytes, absorbing their chaining values into node */
+static void sb_leaves(mbedtls_sha3_context *node, const uint8_t *input, size_t n,
+                      const size_t len, const mbedtls_sha3_id id) {
   
-  return secretbase_sha3_impl(x, bits, convert, hash_object, 0);
+  const size_t cvsz = sha3_families[id].olen / 8;
+  uint8_t cv[SB_LEAF_BATCH * SB_MAX_DIGEST];
+  
+  if (n > 1 && n * len >= SB_LEAF_PAR_MIN && sb_threads() > 1) {
+    const size_t span = len < SB_LEAF_SPAN ? SB_LEAF_SPAN / len : 1;
+    uint8_t *cvs = malloc((n < span ? n : span) * cvsz);
+    if (cvs != NULL) {
+      sb_leaf_task task;
+      task.len = len;
+      task.per = len < SB_LEAF_TASK ? SB_LEAF_TASK / len : 1;
+      task.cv = cvs;
+      task.id = id;
+      while (n > 1 && n * len >= SB_LEAF_PAR_MIN) {
+        task.input = input;
+        task.n = n < span ? n : span;
+        sb_parallel(sb_leaf_task_run, &task, (task.n + task.per - 1) / task.per);
+        mbedtls_sha3_update(node, cvs, task.n * cvsz);
+        input += task.n * len;
+        n -= task.n;
+      }
+      free(cvs);
+    }
+  }
+  
+  while (n) {
+    const size_t m = n < SB_LEAF_BATCH ? n : SB_LEAF_BATCH;
+    sb_leaf_batch(input, m, len, cv, id);
+    mbedtls_sha3_update(node, cv, m * cvsz);
+    input += m * len;
+    n -= m;
+  }
   
 }
 
-SEXP secretbase_sha3_file(SEXP x, SEXP bits, SEXP convert) {
+// secretbase - kangarootwelve ------------------------------------------------
+
+/*
+ *  KangarooTwelve (KT128) hashes the first 8 KiB chunk of input directly into
+ *  the final node. Each further chunk is a leaf, hashed to a 32-byte chaining
+ *  value. Only a trailing partial chunk is ever buffered.
+ */
+
+static void k12_leaves(sb_k12_context *ctx, const uint8_t *input, const size_t n) {
   
-  return secretbase_sha3_impl(x, bits, convert, hash_file, 0);
+  ctx->leaves += n;
+  sb_leaves(&ctx->node, input, n, K12_CHUNK_SIZE, SB_K12_LEAF);
   
 }
 
-SEXP secretbase_shake256(SEXP x, SEXP bits, SEXP convert) {
+/* length_encode(): big-endian with no leading zero bytes, then the byte count */
+static size_t k12_length_encode(uint8_t *enc, const uint64_t x) {
   
-  return secretbase_sha3_impl(x, bits, convert, hash_object, -1);
+  size_t n = 0;
+  for (uint64_t v = x; v; v >>= 8) n++;
+  for (size_t i = 0; i < n; i++)
+    enc[n - 1 - i] = (uint8_t) (x >> (i << 3));
+  enc[n] = (uint8_t) n;
+  
+  return n + 1;
   
 }
 
-SEXP secretbase_shake256_file(SEXP x, SEXP bits, SEXP convert) {
+static void k12_init(sb_k12_context *ctx) {
   
-  return secretbase_sha3_impl(x, bits, convert, hash_file, -1);
+  mbedtls_sha3_init(&ctx->node);
+  mbedtls_sha3_starts(&ctx->node, SB_TURBOSHAKE128);
+  ctx->s0_len = 0;
+  ctx->buf_len = 0;
+  ctx->leaves = 0;
   
 }
 
-SEXP secretbase_keccak(SEXP x, SEXP bits, SEXP convert) {
+static void k12_update(sb_k12_context *ctx, const uint8_t *input, size_t len) {
+  
+  static const uint8_t marker[8] = {0x03, 0, 0, 0, 0, 0, 0, 0};
+  
+  if (len == 0)
+    return;
+  
+  if (ctx->s0_len < K12_CHUNK_SIZE) {
+    const size_t n = K12_CHUNK_SIZE - ctx->s0_len < len ? K12_CHUNK_SIZE - ctx->s0_len : len;
+    mbedtls_sha3_update(&ctx->node, input, n);
+    ctx->s0_len += n;
+    input += n;
+    len -= n;
+  }
+  if (len == 0)
+    return;
+  
+  if (ctx->leaves == 0 && ctx->buf_len == 0)
+    mbedtls_sha3_update(&ctx->node, marker, sizeof(marker));
+  
+  if (ctx->buf_len) {
+    const size_t n = K12_CHUNK_SIZE - ctx->buf_len < len ? K12_CHUNK_SIZE - ctx->buf_len : len;
+    memcpy(ctx->buf + ctx->buf_len, input, n);
+    ctx->buf_len += n;
+    input += n;
+    len -= n;
+    if (ctx->buf_len < K12_CHUNK_SIZE)
+      return;
+    k12_leaves(ctx, ctx->buf, 1);
+    ctx->buf_len = 0;
+  }
+  
+  const size_t n = len / K12_CHUNK_SIZE;
+  if (n) {
+    k12_leaves(ctx, input, n);
+    input += n * K12_CHUNK_SIZE;
+    len -= n * K12_CHUNK_SIZE;
+  }
+  
+  memcpy(ctx->buf, input, len);
+  ctx->buf_len = len;
+  
+}
+
+static void k12_finish(sb_k12_context *ctx, const uint8_t *custom, const size_t clen,
+                       uint8_t *output, const size_t olen) {
+  
+  static const uint8_t terminator[2] = {0xFF, 0xFF};
+  uint8_t enc[9];
+  
+  /* the customization string and its encoded length follow the message */
+  k12_update(ctx, custom, clen);
+  k12_update(ctx, enc, k12_length_encode(enc, (uint64_t) clen));
+  
+  if (ctx->leaves == 0 && ctx->buf_len == 0) {
+    ctx->node.xor_byte = 0x07;
+  } else {
+    if (ctx->buf_len) {
+      uint8_t cv[K12_CV_SIZE];
+      const sb_hash_job job = { ctx->buf, ctx->buf_len, cv };
+      sha3_many(&job, 1, SB_K12_LEAF);
+      mbedtls_sha3_update(&ctx->node, cv, K12_CV_SIZE);
+      ctx->leaves++;
+    }
+    mbedtls_sha3_update(&ctx->node, enc, k12_length_encode(enc, ctx->leaves));
+    mbedtls_sha3_update(&ctx->node, terminator, sizeof(terminator));
+    ctx->node.xor_byte = 0x06;
+  }
+  mbedtls_sha3_finish(&ctx->node, output, olen);
+  
+}
+
+// secretbase - sp 800-185 ----------------------------------------------------
+
+/*
+ *  cSHAKE256 prefixes the SHAKE256 input with its function name and
+ *  customization string, padded to the rate. KMAC256 is a cSHAKE256 whose
+ *  input is prefixed in turn by the padded key, and is finished by the output
+ *  length, so it needs just the one sponge pass. ParallelHash256 is a cSHAKE256
+ *  final node over the SHAKE256 chaining values of fixed-size blocks, so
+ *  blocks are hashed with the shared leaf machinery. Large files are split
+ *  by offset, with each worker reading its own blocks, so that reading is
+ *  parallel as well as hashing.
+ */
+
+#define PH_CV_SIZE 64
+#define PH_FILE_TASK 4194304
+#define PH_FILE_TASKS 256
+
+static size_t sp800_left_encode(uint8_t *enc, const uint64_t x) {
+  
+  size_t n = 1;
+  while (n < 8 && (x >> (n << 3))) n++;
+  enc[0] = (uint8_t) n;
+  for (size_t i = 0; i < n; i++)
+    enc[n - i] = (uint8_t) (x >> (i << 3));
+  
+  return n + 1;
+  
+}
+
+static size_t sp800_right_encode(uint8_t *enc, const uint64_t x) {
+  
+  size_t n = 1;
+  while (n < 8 && (x >> (n << 3))) n++;
+  for (size_t i = 0; i < n; i++)
+    enc[n - 1 - i] = (uint8_t) (x >> (i << 3));
+  enc[n] = (uint8_t) n;
+  
+  return n + 1;
+  
+}
+
+/* bytepad: zeros up to the rate boundary leave the state unchanged */
+static inline void sp800_bytepad(mbedtls_sha3_context *ctx) {
+  
+  if (ctx->index) {
+    keccak_f1600(ctx);
+    ctx->index = 0;
+  }
+  
+}
+
+static void cshake256_starts(mbedtls_sha3_context *ctx, const uint8_t *name, const size_t nlen,
+                             const uint8_t *custom, const size_t clen) {
+  
+  uint8_t enc[9];
+  mbedtls_sha3_init(ctx);
+  mbedtls_sha3_starts(ctx, MBEDTLS_SHA3_SHAKE256);
+  if (nlen == 0 && clen == 0)
+    return;
+  
+  ctx->xor_byte = 0x04;
+  mbedtls_sha3_update(ctx, enc, sp800_left_encode(enc, ctx->max_block_size));
+  mbedtls_sha3_update(ctx, enc, sp800_left_encode(enc, (uint64_t) nlen << 3));
+  mbedtls_sha3_update(ctx, name, nlen);
+  mbedtls_sha3_update(ctx, enc, sp800_left_encode(enc, (uint64_t) clen << 3));
+  mbedtls_sha3_update(ctx, custom, clen);
+  sp800_bytepad(ctx);
+  
+}
+
+static void kmac256_starts(mbedtls_sha3_context *ctx, const uint8_t *key, const size_t klen,
+                           const uint8_t *custom, const size_t clen) {
+  
+  static const uint8_t name[] = "KMAC";
+  uint8_t enc[9];
+  cshake256_starts(ctx, name, sizeof(name) - 1, custom, clen);
+  mbedtls_sha3_update(ctx, enc, sp800_left_encode(enc, ctx->max_block_size));
+  mbedtls_sha3_update(ctx, enc, sp800_left_encode(enc, (uint64_t) klen << 3));
+  mbedtls_sha3_update(ctx, key, klen);
+  sp800_bytepad(ctx);
+  
+}
+
+static void kmac256_finish(mbedtls_sha3_context *ctx, uint8_t *output, const size_t olen) {
+  
+  uint8_t enc[9];
+  mbedtls_sha3_update(ctx, enc, sp800_right_encode(enc, (uint64_t) olen << 3));
+  mbedtls_sha3_finish(ctx, output, olen);
+  
+}
+
+static void ph_init(sb_ph_context *ctx, uint8_t *buf, const size_t block,
+                    const uint8_t *custom, const size_t clen) {
+  
+  static const uint8_t name[] = "ParallelHash";
+  uint8_t enc[9];
+  cshake256_starts(&ctx->node, name, sizeof(name) - 1, custom, clen);
+  mbedtls_sha3_update(&ctx->node, enc, sp800_left_encode(enc, (uint64_t) block));
+  ctx->buf = buf;
+  ctx->block = block;
+  ctx->buf_len = 0;
+  ctx->blocks = 0;
+  
+}
+
+static void ph_update(sb_ph_context *ctx, const uint8_t *input, size_t len) {
+  
+  const size_t block = ctx->block;
+  
+  if (ctx->buf_len) {
+    const size_t n = block - ctx->buf_len < len ? block - ctx->buf_len : len;
+    memcpy(ctx->buf + ctx->buf_len, input, n);
+    ctx->buf_len += n;
+    input += n;
+    len -= n;
+    if (ctx->buf_len < block)
+      return;
+    sb_leaves(&ctx->node, ctx->buf, 1, block, SB_PH256_LEAF);
+    ctx->blocks++;
+    ctx->buf_len = 0;
+  }
+  
+  const size_t n = len / block;
+  if (n) {
+    sb_leaves(&ctx->node, input, n, block, SB_PH256_LEAF);
+    ctx->blocks += n;
+    input += n * block;
+    len -= n * block;
+  }
+  
+  if (len) {
+    memcpy(ctx->buf, input, len);
+    ctx->buf_len = len;
+  }
+  
+}
+
+/* olen of 0 selects the XOF variant, leaving the sponge ready to squeeze */
+static void ph_finish(sb_ph_context *ctx, uint8_t *output, const size_t olen) {
+  
+  uint8_t enc[9];
+  
+  if (ctx->buf_len) {
+    sb_leaves(&ctx->node, ctx->buf, 1, ctx->buf_len, SB_PH256_LEAF);
+    ctx->blocks++;
+    ctx->buf_len = 0;
+  }
+  mbedtls_sha3_update(&ctx->node, enc, sp800_right_encode(enc, ctx->blocks));
+  mbedtls_sha3_update(&ctx->node, enc, sp800_right_encode(enc, (uint64_t) olen << 3));
+  mbedtls_sha3_finish(&ctx->node, output, olen);
+  
+}
+
+typedef struct ph_file_task {
+  const char *path;
+  uint64_t offset;
+  uint64_t end;
+  size_t block;
+  size_t n;
+  size_t per;
+  uint8_t *cv;
+  int *err;
+} ph_file_task;
+
+static void ph_file_task_run(void *arg, size_t i) {
+  
+  const ph_file_task *task = (const ph_file_task *) arg;
+  const size_t off = i * task->per;
+  const size_t n = task->n - off < task->per ? task->n - off : task->per;
+  const uint64_t start = task->offset + (uint64_t) off * task->block;
+  const uint64_t stop = start + (uint64_t) n * task->block;
+  const size_t len = (size_t) ((stop < task->end ? stop : task->end) - start);
+  uint8_t *cv = task->cv + off * PH_CV_SIZE;
+  uint8_t *buf;
+  FILE *f;
+  
+  task->err[i] = 1;
+  if ((buf = malloc(len)) == NULL)
+    return;
+  if ((f = fopen(task->path, "rb")) == NULL) {
+    free(buf);
+    return;
+  }
+  setbuf(f, NULL);
+  if (SB_FSEEK(f, start, SEEK_SET) == 0 && fread(buf, sizeof(char), len, f) == len) {
+    const size_t full = len / task->block;
+    sb_leaf_batch(buf, full, task->block, cv, SB_PH256_LEAF);
+    if (len > full * task->block)
+      sb_leaf_batch(buf + full * task->block, 1, len - full * task->block,
+                    cv + full * PH_CV_SIZE, SB_PH256_LEAF);
+    task->err[i] = 0;
+  }
+  fclose(f);
+  free(buf);
+  
+}
+
+/* hashes a whole file of known size, whose blocks are read by the workers */
+static void ph_file_parallel(sb_ph_context *ctx, const char *path, const uint64_t size) {
+  
+  const size_t block = ctx->block;
+  const uint64_t nblocks = (size + block - 1) / block;
+  const size_t per = block < PH_FILE_TASK ? PH_FILE_TASK / block : 1;
+  size_t ntasks = (size_t) sb_threads() * 4;
+  if (ntasks > PH_FILE_TASKS)
+    ntasks = PH_FILE_TASKS;
+  const size_t span = per * ntasks;
+  int err[PH_FILE_TASKS];
+  
+  uint8_t *cvs = malloc((nblocks < span ? (size_t) nblocks : span) * PH_CV_SIZE);
+  if (cvs == NULL)
+    Rf_error("memory allocation failed");
+  
+  ph_file_task task;
+  task.path = path;
+  task.end = size;
+  task.block = block;
+  task.per = per;
+  task.cv = cvs;
+  task.err = err;
+  
+  for (uint64_t b = 0; b < nblocks; b += task.n) {
+    task.offset = b * block;
+    task.n = nblocks - b < span ? (size_t) (nblocks - b) : span;
+    const size_t nt = (task.n + per - 1) / per;
+    sb_parallel(ph_file_task_run, &task, nt);
+    for (size_t i = 0; i < nt; i++) {
+      if (err[i]) {
+        free(cvs);
+        ERROR_FREAD(path);
+      }
+    }
+    mbedtls_sha3_update(&ctx->node, cvs, task.n * PH_CV_SIZE);
+    ctx->blocks += task.n;
+  }
+  free(cvs);
+  
+}
+
+// secretbase - internals ------------------------------------------------------
+
+#if !defined(MBEDTLS_CT_ASM)
+static void * (*const volatile secure_memset)(void *, int, size_t) = memset;
+#endif
+
+inline void sb_clear_buffer(void *buf, const size_t sz) {
+#ifdef MBEDTLS_CT_ASM
+  memset(buf, 0, sz);
+  asm volatile ("" ::: "memory");
+#else
+  secure_memset(buf, 0, sz);
+#endif
+}
+
+/*
+ *  R serialization writes each item separately, often only 4 bytes at a time.
+ *  These are staged in a buffer and passed on to the hash update function in
+ *  blocks of SB_STAGE_SIZE, with larger writes passed straight through.
+ *
+ *  Where worker threads are enabled, once SB_PIPE_MIN bytes have been hashed
+ *  the blocks are instead handed to a pipeline, so that the hash update runs
+ *  on a worker thread while serialization continues on the calling thread.
+ */
+static void sb_stage_emit(secretbase_context *sctx, const unsigned char *p, const size_t n) {
+  
+  if (sctx->pipe != NULL) {
+    sb_pipe_write(sctx->pipe, p, n);
+    return;
+  }
+  
+  sctx->update(sctx->ctx, p, n);
+  if (sctx->pipe_in) {
+    if (n < sctx->pipe_in) {
+      sctx->pipe_in -= n;
+    } else {
+      sctx->pipe = sb_pipe_start(sctx->ctx, sctx->update);
+      sctx->pipe_in = 0;
+    }
+  }
+  
+}
+
+static void sb_stage_bytes(secretbase_context *sctx, const void *src, size_t n) {
+  
+  const unsigned char *p = (const unsigned char *) src;
+  
+  if (sctx->len + n > SB_STAGE_SIZE) {
+    if (sctx->len) {
+      const size_t fill = SB_STAGE_SIZE - sctx->len;
+      memcpy(sctx->buf + sctx->len, p, fill);
+      sb_stage_emit(sctx, sctx->buf, SB_STAGE_SIZE);
+      sctx->len = 0;
+      p += fill;
+      n -= fill;
+    }
+    if (n >= SB_STAGE_SIZE) {
+      sb_stage_emit(sctx, p, n);
+      return;
+    }
+  }
+  memcpy(sctx->buf + sctx->len, p, n);
+  sctx->len += n;
+  
+}
+
+static void sb_serial_bytes(R_outpstream_t stream, void *src, int len) {
+  
+  secretbase_context *sctx = (secretbase_context *) stream->data;
+  sctx->skip ? (void) sctx->skip-- : sb_stage_bytes(sctx, src, (size_t) len);
+  
+}
+
+/*
+ *  Native serialization skips the conversion of numeric data to big-endian,
+ *  for hashes only compared within the one platform. The stream is preceded
+ *  by a domain prefix so that its hashes are distinct from the portable ones.
+ *
+ *  In this mode, atomic vectors whose attributes are all themselves atomic
+ *  vectors without attributes are hashed directly from memory, bypassing the
+ *  serializer, under a separate prefix. Each vector is framed by its type,
+ *  number of attributes and length, followed by its data in a single update
+ *  (or for character vectors, the length and bytes of each string, with -1
+ *  for NA), then the name and value of each attribute in turn.
+ *
+ *  ALTREP vectors not backed by memory, such as compact sequences, are read
+ *  by region into a bounded buffer rather than materialized. As the bytes
+ *  hashed are the same, so is the digest of the equivalent ordinary vector.
+ */
+static int sb_native_serial = 0;
+static const unsigned char sb_native_prefix[] = "secretbase:native";
+static const unsigned char sb_direct_prefix[] = "secretbase:direct";
+
+static int sb_direct_ok(const SEXP x, const int depth) {
+  
+  switch (TYPEOF(x)) {
+  case STRSXP:
+    break;
+  case LGLSXP:
+  case INTSXP:
+  case REALSXP:
+  case CPLXSXP:
+  case RAWSXP:
+    break;
+  default:
+    return 0;
+  }
+  if (IS_S4_OBJECT(x))
+    return 0;
+  
+  for (SEXP a = ATTRIB(x); a != R_NilValue; a = CDR(a)) {
+    if (depth || !sb_direct_ok(CAR(a), 1))
+      return 0;
+  }
+  
+  return 1;
+  
+}
+
+static inline void sb_direct_string(secretbase_context *sctx, const SEXP c) {
+  
+  const int64_t len = c == NA_STRING ? -1 : (int64_t) LENGTH(c);
+  sb_stage_bytes(sctx, &len, sizeof(int64_t));
+  if (len > 0)
+    sb_stage_bytes(sctx, CHAR(c), (size_t) len);
+  
+}
+
+#define SB_REGION(get, type)                                                  \
+for (R_xlen_t i = 0; i < n; ) {                                               \
+  const R_xlen_t got = get(x, i, SB_STAGE_SIZE / sizeof(type), (type *) buf); \
+  if (got <= 0) break;                                                        \
+  sb_stage_bytes(sctx, buf, (size_t) got * sizeof(type));                     \
+  i += got;                                                                   \
+}
+
+static void sb_direct_data(secretbase_context *sctx, const SEXP x, const R_xlen_t n,
+                           const size_t size) {
+  
+  const void *data = DATAPTR_OR_NULL(x);
+  if (data != NULL) {
+    sb_stage_bytes(sctx, data, (size_t) n * size);
+    return;
+  }
+  
+  double buf[SB_STAGE_SIZE / sizeof(double)];
+  switch (TYPEOF(x)) {
+  case LGLSXP:
+    SB_REGION(LOGICAL_GET_REGION, int);
+    break;
+  case INTSXP:
+    SB_REGION(INTEGER_GET_REGION, int);
+    break;
+  case REALSXP:
+    SB_REGION(REAL_GET_REGION, double);
+    break;
+  case CPLXSXP:
+    SB_REGION(COMPLEX_GET_REGION, Rcomplex);
+    break;
+  case RAWSXP:
+    SB_REGION(RAW_GET_REGION, Rbyte);
+    break;
+  }
+  
+}
+
+#undef SB_REGION
+
+static void sb_direct_node(secretbase_context *sctx, const SEXP x) {
+  
+  const R_xlen_t n = XLENGTH(x);
+  int32_t frame[2] = {TYPEOF(x), 0};
+  for (SEXP a = ATTRIB(x); a != R_NilValue; a = CDR(a))
+    frame[1]++;
+  const int64_t len = (int64_t) n;
+  sb_stage_bytes(sctx, frame, sizeof(frame));
+  sb_stage_bytes(sctx, &len, sizeof(int64_t));
+  
+  switch (TYPEOF(x)) {
+  case STRSXP:
+    for (R_xlen_t i = 0; i < n; i++)
+      sb_direct_string(sctx, STRING_ELT(x, i));
+    break;
+  case LGLSXP:
+  case INTSXP:
+    sb_direct_data(sctx, x, n, sizeof(int));
+    break;
+  case REALSXP:
+    sb_direct_data(sctx, x, n, sizeof(double));
+    break;
+  case CPLXSXP:
+    sb_direct_data(sctx, x, n, sizeof(Rcomplex));
+    break;
+  case RAWSXP:
+    sb_direct_data(sctx, x, n, 1);
+    break;
+  }
+  
+  for (SEXP a = ATTRIB(x); a != R_NilValue; a = CDR(a)) {
+    sb_direct_string(sctx, PRINTNAME(TAG(a)));
+    sb_direct_node(sctx, CAR(a));
+  }
+  
+}
+
+typedef struct sb_serial_args {
+  SEXP x;
+  secretbase_context *sctx;
+} sb_serial_args;
+
+static SEXP sb_serial_body(void *data) {
+  
+  sb_serial_args *args = (sb_serial_args *) data;
+  secretbase_context *sctx = args->sctx;
+  
+  if (sb_native_serial)
+    sb_stage_bytes(sctx, sb_native_prefix, sizeof(sb_native_prefix));
+  
+  struct R_outpstream_st output_stream;
+  R_InitOutPStream(
+    &output_stream,
+    (R_pstream_data_t) sctx,
+    sb_native_serial ? R_pstream_binary_format : R_pstream_xdr_format,
+    SB_R_SERIAL_VER,
+    NULL,
+    sb_serial_bytes,
+    NULL,
+    R_NilValue
+  );
+  R_Serialize(args->x, &output_stream);
+  
+  if (sctx->len) {
+    sb_stage_emit(sctx, sctx->buf, sctx->len);
+    sctx->len = 0;
+  }
+  
+  return R_NilValue;
+  
+}
+
+/* waits for the pipeline to drain, also if serialization raised an error */
+static void sb_serial_cleanup(void *data) {
+  
+  secretbase_context *sctx = (secretbase_context *) data;
+  if (sctx->pipe != NULL) {
+    sb_pipe_finish(sctx->pipe);
+    sctx->pipe = NULL;
+  }
+  
+}
+
+/* hashes the serialization of x, with headers skipped, into ctx */
+void sb_hash_serial(const SEXP x, void *ctx,
+                    void (*update)(void *, const unsigned char *, size_t)) {
+  
+  secretbase_context sctx;
+  sctx.skip = SB_SERIAL_HEADERS;
+  sctx.ctx = ctx;
+  sctx.update = update;
+  sctx.pipe = NULL;
+  sctx.pipe_in = 0;
+  sctx.len = 0;
+  
+  if (sb_native_serial && sb_direct_ok(x, 0)) {
+    sb_stage_bytes(&sctx, sb_direct_prefix, sizeof(sb_direct_prefix));
+    sb_direct_node(&sctx, x);
+    if (sctx.len)
+      update(ctx, sctx.buf, sctx.len);
+    return;
+  }
+  
+  sb_serial_args args = {x, &sctx};
+  if (sb_threads() > 1) {
+    sctx.pipe_in = SB_PIPE_MIN;
+    R_ExecWithCleanup(sb_serial_body, &args, sb_serial_cleanup, &sctx);
+  } else {
+    sb_serial_body(&args);
+  }
+  
+}
+
+/* hashes the bytes of a raw vector, by region for ALTREP vectors not backed by memory */
+void sb_hash_raw(const SEXP x, void *ctx,
+                 void (*update)(void *, const unsigned char *, size_t)) {
+  
+  const R_xlen_t n = XLENGTH(x);
+  const void *data = DATAPTR_OR_NULL(x);
+  if (data != NULL) {
+    update(ctx, (const unsigned char *) data, (size_t) n);
+    return;
+  }
+  
+  unsigned char buf[SB_STAGE_SIZE];
+  for (R_xlen_t i = 0; i < n; ) {
+    const R_xlen_t got = RAW_GET_REGION(x, i, SB_STAGE_SIZE, buf);
+    if (got <= 0) break;
+    update(ctx, buf, (size_t) got);
+    i += got;
+  }
+  
+}
+
+static void hash_bytes(void *ctx, const unsigned char *buf, size_t len) {
+  
+  mbedtls_sha3_update((mbedtls_sha3_context *) ctx, buf, len);
+  
+}
+
+static void hash_file(mbedtls_sha3_context *ctx, const SEXP x) {
+  
+  SB_ASSERT_STR(x);
+  const char *file = R_ExpandFileName(CHAR(*STRING_PTR_RO(x)));
+  unsigned char buf[SB_BUF_SIZE];
+  FILE *f;
+  size_t cur;
+  
+  if ((f = fopen(file, "rb")) == NULL)
+    ERROR_FOPEN(file);
+  
+  setbuf(f, NULL);
+  
+  while ((cur = fread(buf, sizeof(char), SB_BUF_SIZE, f))) {
+    mbedtls_sha3_update(ctx, buf, cur);
+  }
+  
+  if (ferror(f)) {
+    fclose(f);
+    ERROR_FREAD(file);
+  }
+  fclose(f);
+  
+}
+
+static void hash_object(mbedtls_sha3_context *ctx, const SEXP x) {
+  
+  switch (TYPEOF(x)) {
+  case STRSXP:
+    if (XLENGTH(x) == 1 && NO_ATTRIB(x)) {
+      const char *s = CHAR(*STRING_PTR_RO(x));
+      mbedtls_sha3_update(ctx, (uint8_t *) s, strlen(s));
+      return;
+    }
+    break;
+  case RAWSXP:
+    if (NO_ATTRIB(x)) {
+      sb_hash_raw(x, ctx, hash_bytes);
+      return;
+    }
+    break;
+  }
+  
+  sb_hash_serial(x, ctx, hash_bytes);
+  
+}
+
+static void k12_hash_bytes(void *ctx, const unsigned char *buf, size_t len) {
+  
+  k12_update((sb_k12_context *) ctx, buf, len);
+  
+}
+
+static void k12_hash_file(sb_k12_context *ctx, const SEXP x) {
+  
+  SB_ASSERT_STR(x);
+  const char *file = R_ExpandFileName(CHAR(*STRING_PTR_RO(x)));
+  const size_t bufsz = sb_threads() > 1 ? SB_LEAF_FILE_BUF : SB_BUF_SIZE;
+  unsigned char *buf;
+  FILE *f;
+  size_t cur;
+  
+  if ((f = fopen(file, "rb")) == NULL)
+    ERROR_FOPEN(file);
+  
+  if ((buf = malloc(bufsz)) == NULL) {
+    fclose(f);
+    Rf_error("memory allocation failed");
+  }
+  
+  setbuf(f, NULL);
+  
+  while ((cur = fread(buf, sizeof(char), bufsz, f))) {
+    k12_update(ctx, buf, cur);
+  }
+  
+  free(buf);
+  if (ferror(f)) {
+    fclose(f);
+    ERROR_FREAD(file);
+  }
+  fclose(f);
+  
+}
+
+static void k12_hash_object(sb_k12_context *ctx, const SEXP x) {
+  
+  switch (TYPEOF(x)) {
+  case STRSXP:
+    if (XLENGTH(x) == 1 && NO_ATTRIB(x)) {
+      const char *s = CHAR(*STRING_PTR_RO(x));
+      k12_update(ctx, (uint8_t *) s, strlen(s));
+      return;
+    }
+    break;
+  case RAWSXP:
+    if (NO_ATTRIB(x)) {
+      sb_hash_raw(x, ctx, k12_hash_bytes);
+      return;
+    }
+    break;
+  }
+  
+  sb_hash_serial(x, ctx, k12_hash_bytes);
+  
+}
+
+static void ph_hash_bytes(void *ctx, const unsigned char *buf, size_t len) {
+  
+  ph_update((sb_ph_context *) ctx, buf, len);
+  
+}
+
+static void ph_hash_file(sb_ph_context *ctx, const SEXP x) {
+  
+  SB_ASSERT_STR(x);
+  const char *file = R_ExpandFileName(CHAR(*STRING_PTR_RO(x)));
+  const size_t bufsz = sb_threads() > 1 ? SB_LEAF_FILE_BUF : SB_BUF_SIZE;
+  unsigned char *buf;
+  FILE *f;
+  size_t cur;
+  
+  if ((f = fopen(file, "rb")) == NULL)
+    ERROR_FOPEN(file);
+  
+  if (sb_threads() > 1 && SB_FSEEK(f, 0, SEEK_END) == 0) {
+    const int64_t size = (int64_t) SB_FTELL(f);
+    if (size >= SB_LEAF_PAR_MIN) {
+      fclose(f);
+      ph_file_parallel(ctx, file, (uint64_t) size);
+      return;
+    }
+    if (SB_FSEEK(f, 0, SEEK_SET)) {
+      fclose(f);
+      ERROR_FREAD(file);
+    }
+  }
+  
+  if ((buf = malloc(bufsz)) == NULL) {
+    fclose(f);
+    Rf_error("memory allocation failed");
+  }
+  
+  setbuf(f, NULL);
+  
+  while ((cur = fread(buf, sizeof(char), bufsz, f))) {
+    ph_update(ctx, buf, cur);
+  }
+  
+  free(buf);
+  if (ferror(f)) {
+    fclose(f);
+    ERROR_FREAD(file);
+  }
+  fclose(f);
+  
+}
+
+static void ph_hash_object(sb_ph_context *ctx, const SEXP x) {
+  
+  switch (TYPEOF(x)) {
+  case STRSXP:
+    if (XLENGTH(x) == 1 && NO_ATTRIB(x)) {
+      const char *s = CHAR(*STRING_PTR_RO(x));
+      ph_update(ctx, (uint8_t *) s, strlen(s));
+      return;
+    }
+    break;
+  case RAWSXP:
+    if (NO_ATTRIB(x)) {
+      sb_hash_raw(x, ctx, ph_hash_bytes);
+      return;
+    }
+    break;
+  }
+  
+  sb_hash_serial(x, ctx, ph_hash_bytes);
+  
+}
+
+static void sb_hex_c(char *dst, const unsigned char *buf, const size_t sz) {
+
+  static const char hex[] = "0123456789abcdef";
+  for (size_t i = 0; i < sz; i++) {
+    dst[2 * i]     = hex[buf[i] >> 4];
+    dst[2 * i + 1] = hex[buf[i] & 0x0f];
+  }
+
+}
+
+#if defined(SB_X86_SIMD)
+
+#include <immintrin.h>
+
+/* 16 bytes at a time: nibbles are looked up with PSHUFB and interleaved */
+__attribute__((target("ssse3")))
+static void sb_hex_ssse3(char *dst, const unsigned char *buf, const size_t sz) {
+
+  const __m128i lut = _mm_setr_epi8('0', '1', '2', '3', '4', '5', '6', '7',
+                                    '8', '9', 'a', 'b', 'c', 'd', 'e', 'f');
+  const __m128i mask = _mm_set1_epi8(0x0f);
+  size_t i = 0;
+
+  for (; i + 16 <= sz; i += 16) {
+    const __m128i x = _mm_loadu_si128((const __m128i *) (buf + i));
+    const __m128i hi = _mm_shuffle_epi8(lut, _mm_and_si128(_mm_srli_epi16(x, 4), mask));
+    const __m128i lo = _mm_shuffle_epi8(lut, _mm_and_si128(x, mask));
+    _mm_storeu_si128((__m128i *) (dst + 2 * i), _mm_unpacklo_epi8(hi, lo));
+    _mm_storeu_si128((__m128i *) (dst + 2 * i + 16), _mm_unpackhi_epi8(hi, lo));
+  }
+  sb_hex_c(dst + 2 * i, buf + i, sz - i);
+
+}
+
+#endif
+
+static void (*sb_hex)(char *, const unsigned char *, const size_t) = sb_hex_c;
+
+const char * sb_hex_select(const int cpu) {
+
+#if defined(SB_X86_SIMD)
+  if (cpu & SB_CPU_SSSE3) {
+    sb_hex = sb_hex_ssse3;
+    return "ssse3";
+  }
+#endif
+  sb_hex = sb_hex_c;
+  return "portable";
+
+}
+
+SEXP sb_hash_sexp(unsigned char *buf, const size_t sz, const int conv) {
+
+  SEXP out;
+  if (conv == 0) {
+    out = Rf_allocVector(RAWSXP, sz);
+    memcpy(SB_DATAPTR(out), buf, sz);
+  } else if (conv == 1) {
+    if (sz > INT_MAX / 2)
+      Rf_error("hash exceeds the maximum length of a character string");
+    char sbuf[SB_MAX_DIGEST * 2];
+    char *cbuf = sz <= SB_MAX_DIGEST ? sbuf : R_alloc(sz, 2);
+    sb_hex(cbuf, buf, sz);
+    PROTECT(out = Rf_allocVector(STRSXP, 1));
+    SET_STRING_ELT(out, 0, Rf_mkCharLenCE(cbuf, (int) (sz + sz), CE_NATIVE));
+    UNPROTECT(1);
+  } else {
+    const size_t len = (sz + sizeof(int) - 1) / sizeof(int);
+    out = Rf_allocVector(INTSXP, len);
+    memcpy(SB_DATAPTR(out), buf, sz);
+    memset((unsigned char *) SB_DATAPTR(out) + sz, 0, len * sizeof(int) - sz);
+  }
+
+  return out;
+
+}
+
+// buf holds n contiguous digests, each of sz bytes
+SEXP sb_hash_sexp_vec(unsigned char *buf, const size_t sz, const R_xlen_t n, const int conv) {
+
+  SEXP out;
+  if (conv == 1) {
+    if (sz > INT_MAX / 2)
+      Rf_error("hash exceeds the maximum length of a character string");
+    char sbuf[SB_MAX_DIGEST * 2];
+    char *cbuf = sz <= SB_MAX_DIGEST ? sbuf : R_alloc(sz, 2);
+    PROTECT(out = Rf_allocVector(STRSXP, n));
+    for (R_xlen_t i = 0; i < n; i++) {
+      sb_hex(cbuf, buf + i * sz, sz);
+      SET_STRING_ELT(out, i, Rf_mkCharLenCE(cbuf, (int) (sz + sz), CE_NATIVE));
+    }
+    UNPROTECT(1);
+  } else {
+    if (n > INT_MAX)
+      Rf_error("number of hashes exceeds the maximum number of matrix columns");
+    if (conv == 0) {
+      out = Rf_allocMatrix(RAWSXP, (int) sz, (int) n);
+      memcpy(SB_DATAPTR(out), buf, sz * n);
+    } else {
+      const size_t len = (sz + sizeof(int) - 1) / sizeof(int);
+      out = Rf_allocMatrix(INTSXP, (int) len, (int) n);
+      unsigned char *p = (unsigned char *) SB_DATAPTR(out);
+      for (R_xlen_t i = 0; i < n; i++) {
+        memcpy(p + i * len * sizeof(int), buf + i * sz, sz);
+        memset(p + i * len * sizeof(int) + sz, 0, len * sizeof(int) - sz);
+      }
+    }
+  }
+
+  return out;
+
+}
+
+static mbedtls_sha3_id sb_sha3_id(const int bt, const int offset) {
+  
+  mbedtls_sha3_id id;
+  
+  if (offset < 0) {
+    if (bt < 8 || bt > (1 << 24))
+      Rf_error("'bits' outside valid range of 8 to 2^24");
+    id = offset == -1 ? MBEDTLS_SHA3_SHAKE256 : SB_SHAKE128;
+  } else {
+    switch(bt) {
+    case 256:
+      id = MBEDTLS_SHA3_256 + offset; break;
+    case 512:
+      id = MBEDTLS_SHA3_512 + offset; break;
+    case 224:
+      id = MBEDTLS_SHA3_224 + offset; break;
+    case 384:
+      id = MBEDTLS_SHA3_384 + offset; break;
+    default:
+      id = MBEDTLS_SHA3_SHAKE256;
+      Rf_error("'bits' must be 224, 256, 384 or 512");
+    }
+  }
+  
+  return id;
+  
+}
+
+static SEXP secretbase_sha3_impl(const SEXP x, const SEXP bits, const SEXP convert,
+                                 void (*const hash_func)(mbedtls_sha3_context *, SEXP),
+                                 const int offset) {
+  
+  SB_ASSERT_LOGICAL(convert);
+  const int conv = SB_LOGICAL(convert);
+  const int bt = sb_integer(bits);
+  const mbedtls_sha3_id id = sb_sha3_id(bt, offset);
+  
+  const size_t sz = (size_t) (bt / 8);
+  unsigned char sbuf[SB_MAX_DIGEST];
+  unsigned char *buf = sz <= SB_MAX_DIGEST ? sbuf : (unsigned char *) R_alloc(sz, 1);
+  
+  mbedtls_sha3_context ctx;
+  mbedtls_sha3_init(&ctx);
+  mbedtls_sha3_starts(&ctx, id);
+  hash_func(&ctx, x);
+  mbedtls_sha3_finish(&ctx, buf, sz);
+  sb_clear_buffer(&ctx, sizeof(mbedtls_sha3_context));
+  
+  return sb_hash_sexp(buf, sz, conv);
+  
+}
+
+static SEXP secretbase_turboshake_impl(const SEXP x, const SEXP bits, const SEXP domain,
+                                       const SEXP convert,
+                                       void (*const hash_func)(mbedtls_sha3_context *, SEXP),
+                                       const mbedtls_sha3_id id) {
+  
+  SB_ASSERT_LOGICAL(convert);
+  const int conv = SB_LOGICAL(convert);
+  const int bt = sb_integer(bits);
+  if (bt < 8 || bt > (1 << 24))
+    Rf_error("'bits' outside valid range of 8 to 2^24");
+  const int dom = sb_integer(domain);
+  if (dom < 1 || dom > 127)
+    Rf_error("'domain' must be an integer between 1 and 127");
+  
+  const size_t sz = (size_t) (bt / 8);
+  unsigned char sbuf[SB_MAX_DIGEST];
+  unsigned char *buf = sz <= SB_MAX_DIGEST ? sbuf : (unsigned char *) R_alloc(sz, 1);
+  
+  mbedtls_sha3_context ctx;
+  mbedtls_sha3_init(&ctx);
+  mbedtls_sha3_starts(&ctx, id);
+  ctx.xor_byte = (uint8_t) dom;
+  hash_func(&ctx, x);
+  mbedtls_sha3_finish(&ctx, buf, sz);
+  sb_clear_buffer(&ctx, sizeof(mbedtls_sha3_context));
+  
+  return sb_hash_sexp(buf, sz, conv);
+  
+}
+
+static void sb_custom(const SEXP custom, const uint8_t **cs, size_t *clen) {
+  
+  switch (TYPEOF(custom)) {
+  case NILSXP:
+    *cs = NULL;
+    *clen = 0;
+    break;
+  case STRSXP:
+    *cs = (const uint8_t *) (XLENGTH(custom) ? CHAR(*STRING_PTR_RO(custom)) : "");
+    *clen = strlen((const char *) *cs);
+    break;
+  case RAWSXP:
+    *cs = (const uint8_t *) DATAPTR_RO(custom);
+    *clen = (size_t) XLENGTH(custom);
+    break;
+  default:
+    Rf_error("'custom' must be a character string, raw vector or NULL");
+  }
+  
+}
+
+static void sb_kmac_key(const SEXP key, const uint8_t **k, size_t *klen) {
+  
+  switch (TYPEOF(key)) {
+  case STRSXP:
+    *k = (const uint8_t *) (XLENGTH(key) ? CHAR(*STRING_PTR_RO(key)) : "");
+    *klen = strlen((const char *) *k);
+    break;
+  case RAWSXP:
+    *k = (const uint8_t *) DATAPTR_RO(key);
+    *klen = (size_t) XLENGTH(key);
+    break;
+  default:
+    Rf_error("'key' must be a character string or raw vector");
+  }
+  
+}
+
+static size_t sb_ph_block(const SEXP block) {
+  
+  const int blk = sb_integer(block);
+  if (blk < 1 || blk > (1 << 24))
+    Rf_error("'block' must be an integer between 1 and 2^24");
+  
+  return (size_t) blk;
+  
+}
+
+static SEXP secretbase_k12_impl(const SEXP x, const SEXP bits, const SEXP custom,
+                                const SEXP convert,
+                                void (*const hash_func)(sb_k12_context *, SEXP)) {
+  
+  SB_ASSERT_LOGICAL(convert);
+  const int conv = SB_LOGICAL(convert);
+  const int bt = sb_integer(bits);
+  if (bt < 8 || bt > (1 << 24))
+    Rf_error("'bits' outside valid range of 8 to 2^24");
+  
+  const uint8_t *cs;
+  size_t clen;
+  sb_custom(custom, &cs, &clen);
+  
+  const size_t sz = (size_t) (bt / 8);
+  unsigned char sbuf[SB_MAX_DIGEST];
+  unsigned char *buf = sz <= SB_MAX_DIGEST ? sbuf : (unsigned char *) R_alloc(sz, 1);
+  
+  sb_k12_context ctx;
+  k12_init(&ctx);
+  hash_func(&ctx, x);
+  k12_finish(&ctx, cs, clen, buf, sz);
+  sb_clear_buffer(&ctx, sizeof(sb_k12_context));
+  
+  return sb_hash_sexp(buf, sz, conv);
+  
+}
+
+static SEXP secretbase_cshake256_impl(const SEXP x, const SEXP bits, const SEXP key,
+                                      const SEXP custom, const SEXP convert,
+                                      void (*const hash_func)(mbedtls_sha3_context *, SEXP)) {
+  
+  SB_ASSERT_LOGICAL(convert);
+  const int conv = SB_LOGICAL(convert);
+  const int bt = sb_integer(bits);
+  if (bt < 8 || bt > (1 << 24))
+    Rf_error("'bits' outside valid range of 8 to 2^24");
+  const uint8_t *cs, *k = NULL;
+  size_t clen, klen = 0;
+  sb_custom(custom, &cs, &clen);
+  if (key != R_NilValue)
+    sb_kmac_key(key, &k, &klen);
+  
+  const size_t sz = (size_t) (bt / 8);
+  unsigned char sbuf[SB_MAX_DIGEST];
+  unsigned char *buf = sz <= SB_MAX_DIGEST ? sbuf : (unsigned char *) R_alloc(sz, 1);
+  
+  mbedtls_sha3_context ctx;
+  if (key == R_NilValue) {
+    cshake256_starts(&ctx, NULL, 0, cs, clen);
+    hash_func(&ctx, x);
+    mbedtls_sha3_finish(&ctx, buf, sz);
+  } else {
+    kmac256_starts(&ctx, k, klen, cs, clen);
+    hash_func(&ctx, x);
+    kmac256_finish(&ctx, buf, sz);
+  }
+  sb_clear_buffer(&ctx, sizeof(mbedtls_sha3_context));
+  
+  return sb_hash_sexp(buf, sz, conv);
+  
+}
+
+static SEXP secretbase_ph_impl(const SEXP x, const SEXP bits, const SEXP block,
+                               const SEXP custom, const SEXP convert,
+                               void (*const hash_func)(sb_ph_context *, SEXP)) {
+  
+  SB_ASSERT_LOGICAL(convert);
+  const int conv = SB_LOGICAL(convert);
+  const int bt = sb_integer(bits);
+  if (bt < 8 || bt > (1 << 24))
+    Rf_error("'bits' outside valid range of 8 to 2^24");
+  const size_t blk = sb_ph_block(block);
+  const uint8_t *cs;
+  size_t clen;
+  sb_custom(custom, &cs, &clen);
+  
+  const size_t sz = (size_t) (bt / 8);
+  unsigned char sbuf[SB_MAX_DIGEST];
+  unsigned char *buf = sz <= SB_MAX_DIGEST ? sbuf : (unsigned char *) R_alloc(sz, 1);
+  
+  sb_ph_context ctx;
+  ph_init(&ctx, (uint8_t *) R_alloc(blk, 1), blk, cs, clen);
+  hash_func(&ctx, x);
+  ph_finish(&ctx, buf, sz);
+  sb_clear_buffer(&ctx, sizeof(sb_ph_context));
+  
+  return sb_hash_sexp(buf, sz, conv);
+  
+}
+
+static SEXP secretbase_sha3_vec_impl(const SEXP x, const SEXP bits, const SEXP convert,
+                                     const int offset) {
+  
+  SB_ASSERT_LOGICAL(convert);
+  const int conv = SB_LOGICAL(convert);
+  const mbedtls_sha3_id id = sb_sha3_id(sb_integer(bits), offset);
+  const size_t sz = sha3_families[id].olen / 8;
+  const R_xlen_t n = XLENGTH(x);
+  size_t njobs = 0;
+  
+  unsigned char *buf = (unsigned char *) R_alloc(n ? n : 1, (int) sz);
+  sb_hash_job *jobs = (sb_hash_job *) R_alloc(n ? n : 1, sizeof(sb_hash_job));
+  
+  switch (TYPEOF(x)) {
+  case STRSXP: {
+    const SEXP *p = STRING_PTR_RO(x);
+    for (R_xlen_t i = 0; i < n; i++) {
+      jobs[njobs++] = (sb_hash_job) {
+        (const unsigned char *) CHAR(p[i]), (size_t) LENGTH(p[i]), buf + i * sz
+      };
+    }
+    break;
+  }
+  case VECSXP: {
+    mbedtls_sha3_context ctx;
+    for (R_xlen_t i = 0; i < n; i++) {
+      const SEXP el = VECTOR_ELT(x, i);
+      if (TYPEOF(el) == STRSXP && XLENGTH(el) == 1 && NO_ATTRIB(el)) {
+        const char *s = CHAR(*STRING_PTR_RO(el));
+        jobs[njobs++] = (sb_hash_job) { (const unsigned char *) s, strlen(s), buf + i * sz };
+      } else if (TYPEOF(el) == RAWSXP && NO_ATTRIB(el)) {
+        jobs[njobs++] = (sb_hash_job) {
+          (const unsigned char *) DATAPTR_RO(el), (size_t) XLENGTH(el), buf + i * sz
+        };
+      } else {
+        mbedtls_sha3_init(&ctx);
+        mbedtls_sha3_starts(&ctx, id);
+        hash_object(&ctx, el);
+        mbedtls_sha3_finish(&ctx, buf + i * sz, sz);
+      }
+    }
+    sb_clear_buffer(&ctx, sizeof(mbedtls_sha3_context));
+    break;
+  }
+  default:
+    Rf_error("'x' must be a character vector or list");
+  }
+  
+  sha3_many(jobs, njobs, id);
+  
+  return sb_hash_sexp_vec(buf, sz, n, conv);
+  
+}
+
+static void xof_finalizer(SEXP xptr) {
+  
+  mbedtls_sha3_context *ctx = (mbedtls_sha3_context *) R_ExternalPtrAddr(xptr);
+  if (ctx == NULL) return;
+  sb_clear_buffer(ctx, sizeof(mbedtls_sha3_context));
+  free(ctx);
+  R_ClearExternalPtr(xptr);
+  
+}
+
+static mbedtls_sha3_context * sb_xof_ctx(const SEXP xof) {
+  
+  if (TYPEOF(xof) != EXTPTRSXP || !Rf_inherits(xof, "secretbase_xof"))
+    Rf_error("'xof' is not a valid XOF");
+  mbedtls_sha3_context *ctx = (mbedtls_sha3_context *) R_ExternalPtrAddr(xof);
+  if (ctx == NULL)
+    Rf_error("'xof' is not a valid XOF");
+  
+  return ctx;
+  
+}
+
+static size_t sb_xof_bytes(const SEXP bytes) {
+  
+  const double b = Rf_asReal(bytes);
+  if (!(b >= 0 && b <= (double) R_XLEN_T_MAX))
+    Rf_error("'bytes' must be a non-negative number");
+  
+  return (size_t) b;
+  
+}
+
+/* wraps a newly allocated sponge context, freed by the finalizer */
+static SEXP sb_xof_xptr(mbedtls_sha3_context **ctx, const char *algo) {
+  
+  if ((*ctx = malloc(sizeof(mbedtls_sha3_context))) == NULL)
+    Rf_error("memory allocation failed");
+  
+  SEXP xptr, klass;
+  PROTECT(xptr = R_MakeExternalPtr(*ctx, R_NilValue, R_NilValue));
+  R_RegisterCFinalizerEx(xptr, xof_finalizer, TRUE);
+  klass = Rf_mkString("secretbase_xof");
+  Rf_classgets(xptr, klass);
+  Rf_setAttrib(xptr, Rf_install("algorithm"), Rf_mkString(algo));
+  
+  UNPROTECT(1);
+  return xptr;
+  
+}
+
+static SEXP secretbase_xof_impl(const SEXP x, void (*const hash_func)(mbedtls_sha3_context *, SEXP),
+                                const mbedtls_sha3_id id) {
+  
+  mbedtls_sha3_context *ctx;
+  SEXP xptr;
+  PROTECT(xptr = sb_xof_xptr(&ctx, "SHAKE256"));
+  
+  mbedtls_sha3_init(ctx);
+  mbedtls_sha3_starts(ctx, id);
+  hash_func(ctx, x);
+  mbedtls_sha3_finish(ctx, NULL, 0);
+  
+  UNPROTECT(1);
+  return xptr;
+  
+}
+
+static SEXP secretbase_ph_xof_impl(const SEXP x, const SEXP block, const SEXP custom,
+                                   void (*const hash_func)(sb_ph_context *, SEXP)) {
+  
+  const size_t blk = sb_ph_block(block);
+  const uint8_t *cs;
+  size_t clen;
+  sb_custom(custom, &cs, &clen);
+  
+  mbedtls_sha3_context *xctx;
+  SEXP xptr;
+  PROTECT(xptr = sb_xof_xptr(&xctx, "ParallelHash256"));
+  mbedtls_sha3_init(xctx);
+  
+  sb_ph_context ctx;
+  ph_init(&ctx, (uint8_t *) R_alloc(blk, 1), blk, cs, clen);
+  hash_func(&ctx, x);
+  ph_finish(&ctx, NULL, 0);
+  memcpy(xctx, &ctx.node, sizeof(mbedtls_sha3_context));
+  sb_clear_buffer(&ctx, sizeof(sb_ph_context));
+  
+  UNPROTECT(1);
+  return xptr;
+  
+}
+
+// secretbase - hashing contexts -----------------------------------------------
+
+static const char * sha3_ctx_init(void *ctx, const SEXP bits, const SEXP key, size_t *size) {
+  
+  if (key != R_NilValue)
+    Rf_error("'key' is not supported for \"sha3\"");
+  const int bt = sb_integer(bits);
+  const mbedtls_sha3_id id = sb_sha3_id(bt, 0);
+  mbedtls_sha3_init((mbedtls_sha3_context *) ctx);
+  mbedtls_sha3_starts((mbedtls_sha3_context *) ctx, id);
+  *size = (size_t) (bt / 8);
+  
+  return id == MBEDTLS_SHA3_224 ? "SHA3-224" : id == MBEDTLS_SHA3_256 ? "SHA3-256" :
+    id == MBEDTLS_SHA3_384 ? "SHA3-384" : "SHA3-512";
+  
+}
+
+static void sha3_ctx_update(void *ctx, const unsigned char *buf, size_t len) {
+  
+  mbedtls_sha3_update((mbedtls_sha3_context *) ctx, buf, len);
+  
+}
+
+static void sha3_ctx_digest(const void *ctx, unsigned char *out) {
+  
+  mbedtls_sha3_context c = *(const mbedtls_sha3_context *) ctx;
+  mbedtls_sha3_finish(&c, out, c.olen);
+  sb_clear_buffer(&c, sizeof(mbedtls_sha3_context));
+  
+}
+
+/* validates a restored state against the parameters for its digest size */
+static int sha3_ctx_check(const void *ctx, size_t size) {
+  
+  const mbedtls_sha3_context *c = (const mbedtls_sha3_context *) ctx;
+  mbedtls_sha3_context ref;
+  if (size != 28 && size != 32 && size != 48 && size != 64)
+    return 0;
+  const mbedtls_sha3_id id = size == 28 ? MBEDTLS_SHA3_224 : size == 32 ? MBEDTLS_SHA3_256 :
+    size == 48 ? MBEDTLS_SHA3_384 : MBEDTLS_SHA3_512;
+  mbedtls_sha3_starts(&ref, id);
+  
+  return c->olen == size && c->r == ref.r && c->olen == ref.olen && c->xor_byte == ref.xor_byte &&
+    c->max_block_size == ref.max_block_size && c->rounds == ref.rounds &&
+    c->index < c->max_block_size;
+  
+}
+
+const sb_hash_ops sb_sha3_ops = {
+  sizeof(mbedtls_sha3_context), sha3_ctx_init, sha3_ctx_update, sha3_ctx_digest,
+  sha3_ctx_check
+};
+
+// secretbase - exported functions ---------------------------------------------
+
+SEXP secretbase_sha3(SEXP x, SEXP bits, SEXP convert) {
+  
+  return secretbase_sha3_impl(x, bits, convert, hash_object, 0);
+  
+}
+
+SEXP secretbase_sha3_file(SEXP x, SEXP bits, SEXP convert) {
+  
+  return secretbase_sha3_impl(x, bits, convert, hash_file, 0);
+  
+}
+
+SEXP secretbase_shake128(SEXP x, SEXP bits, SEXP convert) {
+  
+  return secretbase_sha3_impl(x, bits, convert, hash_object, -2);
+  
+}
+
+SEXP secretbase_shake128_file(SEXP x, SEXP bits, SEXP convert) {
+  
+  return secretbase_sha3_impl(x, bits, convert, hash_file, -2);
+  
+}
+
+SEXP secretbase_shake256(SEXP x, SEXP bits, SEXP convert) {
+  
+  return secretbase_sha3_impl(x, bits, convert, hash_object, -1);
+  
+}
+
+SEXP secretbase_shake256_file(SEXP x, SEXP bits, SEXP convert) {
+  
+  return secretbase_sha3_impl(x, bits, convert, hash_file, -1);
+  
+}
+
+SEXP secretbase_turboshake128(SEXP x, SEXP bits, SEXP domain, SEXP convert) {
+  
+  return secretbase_turboshake_impl(x, bits, domain, convert, hash_object, SB_TURBOSHAKE128);
+  
+}
+
+SEXP secretbase_turboshake128_file(SEXP x, SEXP bits, SEXP domain, SEXP convert) {
+  
+  return secretbase_turboshake_impl(x, bits, domain, convert, hash_file, SB_TURBOSHAKE128);
+  
+}
+
+SEXP secretbase_turboshake256(SEXP x, SEXP bits, SEXP domain, SEXP convert) {
+  
+  return secretbase_turboshake_impl(x, bits, domain, convert, hash_object, SB_TURBOSHAKE256);
+  
+}
+
+SEXP secretbase_turboshake256_file(SEXP x, SEXP bits, SEXP domain, SEXP convert) {
+  
+  return secretbase_turboshake_impl(x, bits, domain, convert, hash_file, SB_TURBOSHAKE256);
+  
+}
+
+SEXP secretbase_k12(SEXP x, SEXP bits, SEXP custom, SEXP convert) {
+  
+  return secretbase_k12_impl(x, bits, custom, convert, k12_hash_object);
+  
+}
+
+SEXP secretbase_k12_file(SEXP x, SEXP bits, SEXP custom, SEXP convert) {
+  
+  return secretbase_k12_impl(x, bits, custom, convert, k12_hash_file);
+  
+}
+
+SEXP secretbase_cshake256(SEXP x, SEXP bits, SEXP custom, SEXP convert) {
+  
+  return secretbase_cshake256_impl(x, bits, R_NilValue, custom, convert, hash_object);
+  
+}
+
+SEXP secretbase_cshake256_file(SEXP x, SEXP bits, SEXP custom, SEXP convert) {
+  
+  return secretbase_cshake256_impl(x, bits, R_NilValue, custom, convert, hash_file);
+  
+}
+
+SEXP secretbase_kmac256(SEXP x, SEXP key, SEXP bits, SEXP custom, SEXP convert) {
+  
+  if (key == R_NilValue)
+    Rf_error("'key' must be a character string or raw vector");
+  
+  return secretbase_cshake256_impl(x, bits, key, custom, convert, hash_object);
+  
+}
+
+SEXP secretbase_kmac256_file(SEXP x, SEXP key, SEXP bits, SEXP custom, SEXP convert) {
+  
+  if (key == R_NilValue)
+    Rf_error("'key' must be a character string or raw vector");
+  
+  return secretbase_cshake256_impl(x, bits, key, custom, convert, hash_file);
+  
+}
+
+SEXP secretbase_parallelhash256(SEXP x, SEXP bits, SEXP block, SEXP custom, SEXP convert) {
+  
+  return secretbase_ph_impl(x, bits, block, custom, convert, ph_hash_object);
+  
+}
+
+SEXP secretbase_parallelhash256_file(SEXP x, SEXP bits, SEXP block, SEXP custom, SEXP convert) {
+  
+  return secretbase_ph_impl(x, bits, block, custom, convert, ph_hash_file);
+  
+}
+
+SEXP secretbase_parallelhash256_xof(SEXP x, SEXP block, SEXP custom) {
+  
+  return secretbase_ph_xof_impl(x, block, custom, ph_hash_object);
+  
+}
+
+SEXP secretbase_parallelhash256_xof_file(SEXP x, SEXP block, SEXP custom) {
+  
+  return secretbase_ph_xof_impl(x, block, custom, ph_hash_file);
+  
+}
+
+SEXP secretbase_keccak(SEXP x, SEXP bits, SEXP convert) {
   
   return secretbase_sha3_impl(x, bits, convert, hash_object, 4);
   
@@ -391,3 +2305,82 @@ SEXP secretbase_keccak_file(SEXP x, SEXP bits, SEXP convert) {
   return secretbase_sha3_impl(x, bits, convert, hash_file, 4);
   
 }
+
+SEXP secretbase_sha3_vec(SEXP x, SEXP bits, SEXP convert) {
+  
+  return secretbase_sha3_vec_impl(x, bits, convert, 0);
+  
+}
+
+SEXP secretbase_keccak_vec(SEXP x, SEXP bits, SEXP convert) {
+  
+  return secretbase_sha3_vec_impl(x, bits, convert, 4);
+  
+}
+
+SEXP secretbase_shake256_xof(SEXP x) {
+  
+  return secretbase_xof_impl(x, hash_object, MBEDTLS_SHA3_SHAKE256);
+  
+}
+
+SEXP secretbase_shake256_xof_file(SEXP x) {
+  
+  return secretbase_xof_impl(x, hash_file, MBEDTLS_SHA3_SHAKE256);
+  
+}
+
+SEXP secretbase_xof_read(SEXP xof, SEXP bytes, SEXP convert) {
+  
+  SB_ASSERT_LOGICAL(convert);
+  const int conv = SB_LOGICAL(convert);
+  mbedtls_sha3_context *ctx = sb_xof_ctx(xof);
+  const size_t sz = sb_xof_bytes(bytes);
+  
+  unsigned char *buf = (unsigned char *) R_alloc(sz ? sz : 1, 1);
+  mbedtls_sha3_squeeze(ctx, buf, sz);
+  
+  return sb_hash_sexp(buf, sz, conv);
+  
+}
+
+SEXP secretbase_xof_read_file(SEXP xof, SEXP bytes, SEXP file) {
+  
+  mbedtls_sha3_context *ctx = sb_xof_ctx(xof);
+  size_t sz = sb_xof_bytes(bytes);
+  SB_ASSERT_STR(file);
+  const char *path = R_ExpandFileName(CHAR(*STRING_PTR_RO(file)));
+  unsigned char buf[SB_BUF_SIZE];
+  FILE *f;
+  
+  if ((f = fopen(path, "ab")) == NULL)
+    ERROR_FOPEN_W(path);
+  
+  while (sz > 0) {
+    const size_t n = sz < SB_BUF_SIZE ? sz : SB_BUF_SIZE;
+    mbedtls_sha3_squeeze(ctx, buf, n);
+    if (fwrite(buf, sizeof(char), n, f) != n) {
+      fclose(f);
+      ERROR_FWRITE(path);
+    }
+    sz -= n;
+  }
+  
+  if (fclose(f))
+    ERROR_FWRITE(path);
+  
+  return xof;
+  
+}
+
+SEXP secretbase_serialization(SEXP native) {
+  
+  if (native != R_NilValue) {
+    if (TYPEOF(native) != LGLSXP || XLENGTH(native) != 1 || SB_LOGICAL(native) == NA_LOGICAL)
+      Rf_error("'native' must be a logical value");
+    sb_native_serial = SB_LOGICAL(native);
+  }
+  
+  return Rf_ScalarLogical(sb_native_serial);
+  
+}
@@ -0,0 +1,414 @@
+// secretbase ------------------------------------------------------------------
+
+#include "secret.h"
+
+// secretbase - sha512 implementation ------------------------------------------
+
+/*
+ *  FIPS-180-2 compliant SHA-384/512 implementation
+ *
+ *  Copyright The Mbed TLS Contributors
+ *  SPDX-License-Identifier: Apache-2.0 OR GPL-2.0-or-later
+ */
+/*
+ *  The SHA-512 Secure Hash Standard was published by NIST in 2002.
+ *
+ *  http://csrc.nist.gov/publications/fips/fips180-2/fips180-2.pdf
+ *
+ *  The SHA-512/256 initial hash value is specified in FIPS 180-4 section
+ *  5.3.6, https://doi.org/10.6028/NIST.FIPS.180-4
+ */
+
+static void mbedtls_sha512_init(mbedtls_sha512_context *ctx) {
+  
+  memset(ctx, 0, sizeof(mbedtls_sha512_context));
+  
+}
+
+/* olen is the digest size in bytes, selecting SHA-512, SHA-384 or SHA-512/256 */
+static void mbedtls_sha512_starts(mbedtls_sha512_context *ctx, const size_t olen) {
+  
+  ctx->total[0] = 0;
+  ctx->total[1] = 0;
+  ctx->olen = olen;
+  
+  switch (olen) {
+  case 48:
+    ctx->state[0] = UINT64_C(0xCBBB9D5DC1059ED8);
+    ctx->state[1] = UINT64_C(0x629A292A367CD507);
+    ctx->state[2] = UINT64_C(0x9159015A3070DD17);
+    ctx->state[3] = UINT64_C(0x152FECD8F70E5939);
+    ctx->state[4] = UINT64_C(0x67332667FFC00B31);
+    ctx->state[5] = UINT64_C(0x8EB44A8768581511);
+    ctx->state[6] = UINT64_C(0xDB0C2E0D64F98FA7);
+    ctx->state[7] = UINT64_C(0x47B5481DBEFA4FA4);
+    break;
+  case 32:
+    ctx->state[0] = UINT64_C(0x22312194FC2BF72C);
+    ctx->state[1] = UINT64_C(0x9F555FA3C84C64C2);
+    ctx->state[2] = UINT64_C(0x2393B86B6F53B151);
+    ctx->state[3] = UINT64_C(0x963877195940EABD);
+    ctx->state[4] = UINT64_C(0x96283EE2A88EFFE3);
+    ctx->state[5] = UINT64_C(0xBE5E1E2553863992);
+    ctx->state[6] = UINT64_C(0x2B0199FC2C85B8AA);
+    ctx->state[7] = UINT64_C(0x0EB72DDC81C52CA2);
+    break;
+  default:
+    ctx->state[0] = UINT64_C(0x6A09E667F3BCC908);
+    ctx->state[1] = UINT64_C(0xBB67AE8584CAA73B);
+    ctx->state[2] = UINT64_C(0x3C6EF372FE94F82B);
+    ctx->state[3] = UINT64_C(0xA54FF53A5F1D36F1);
+    ctx->state[4] = UINT64_C(0x510E527FADE682D1);
+    ctx->state[5] = UINT64_C(0x9B05688C2B3E6C1F);
+    ctx->state[6] = UINT64_C(0x1F83D9ABFB41BD6B);
+    ctx->state[7] = UINT64_C(0x5BE0CD19137E2179);
+  }
+  
+}
+
+static const uint64_t K[80] =
+  {
+  UINT64_C(0x428A2F98D728AE22), UINT64_C(0x7137449123EF65CD),
+  UINT64_C(0xB5C0FBCFEC4D3B2F), UINT64_C(0xE9B5DBA58189DBBC),
+  UINT64_C(0x3956C25BF348B538), UINT64_C(0x59F111F1B605D019),
+  UINT64_C(0x923F82A4AF194F9B), UINT64_C(0xAB1C5ED5DA6D8118),
+  UINT64_C(0xD807AA98A3030242), UINT64_C(0x12835B0145706FBE),
+  UINT64_C(0x243185BE4EE4B28C), UINT64_C(0x550C7DC3D5FFB4E2),
+  UINT64_C(0x72BE5D74F27B896F), UINT64_C(0x80DEB1FE3B1696B1),
+  UINT64_C(0x9BDC06A725C71235), UINT64_C(0xC19BF174CF692694),
+  UINT64_C(0xE49B69C19EF14AD2), UINT64_C(0xEFBE4786384F25E3),
+  UINT64_C(0x0FC19DC68B8CD5B5), UINT64_C(0x240CA1CC77AC9C65),
+  UINT64_C(0x2DE92C6F592B0275), UINT64_C(0x4A7484AA6EA6E483),
+  UINT64_C(0x5CB0A9DCBD41FBD4), UINT64_C(0x76F988DA831153B5),
+  UINT64_C(0x983E5152EE66DFAB), UINT64_C(0xA831C66D2DB43210),
+  UINT64_C(0xB00327C898FB213F), UINT64_C(0xBF597FC7BEEF0EE4),
+  UINT64_C(0xC6E00BF33DA88FC2), UINT64_C(0xD5A79147930AA725),
+  UINT64_C(0x06CA6351E003826F), UINT64_C(0x142929670A0E6E70),
+  UINT64_C(0x27B70A8546D22FFC), UINT64_C(0x2E1B21385C26C926),
+  UINT64_C(0x4D2C6DFC5AC42AED), UINT64_C(0x53380D139D95B3DF),
+  UINT64_C(0x650A73548BAF63DE), UINT64_C(0x766A0ABB3C77B2A8),
+  UINT64_C(0x81C2C92E47EDAEE6), UINT64_C(0x92722C851482353B),
+  UINT64_C(0xA2BFE8A14CF10364), UINT64_C(0xA81A664BBC423001),
+  UINT64_C(0xC24B8B70D0F89791), UINT64_C(0xC76C51A30654BE30),
+  UINT64_C(0xD192E819D6EF5218), UINT64_C(0xD69906245565A910),
+  UINT64_C(0xF40E35855771202A), UINT64_C(0x106AA07032BBD1B8),
+  UINT64_C(0x19A4C116B8D2D0C8), UINT64_C(0x1E376C085141AB53),
+  UINT64_C(0x2748774CDF8EEB99), UINT64_C(0x34B0BCB5E19B48A8),
+  UINT64_C(0x391C0CB3C5C95A63), UINT64_C(0x4ED8AA4AE3418ACB),
+  UINT64_C(0x5B9CCA4F7763E373), UINT64_C(0x682E6FF3D6B2B8A3),
+  UINT64_C(0x748F82EE5DEFB2FC), UINT64_C(0x78A5636F43172F60),
+  UINT64_C(0x84C87814A1F0AB72), UINT64_C(0x8CC702081A6439EC),
+  UINT64_C(0x90BEFFFA23631E28), UINT64_C(0xA4506CEBDE82BDE9),
+  UINT64_C(0xBEF9A3F7B2C67915), UINT64_C(0xC67178F2E372532B),
+  UINT64_C(0xCA273ECEEA26619C), UINT64_C(0xD186B8C721C0C207),
+  UINT64_C(0xEADA7DD6CDE0EB1E), UINT64_C(0xF57D4F7FEE6ED178),
+  UINT64_C(0x06F067AA72176FBA), UINT64_C(0x0A637DC5A2C898A6),
+  UINT64_C(0x113F9804BEF90DAE), UINT64_C(0x1B710B35131C471B),
+  UINT64_C(0x28DB77F523047D84), UINT64_C(0x32CAAB7B40C72493),
+  UINT64_C(0x3C9EBE0A15C9BEBC), UINT64_C(0x431D67C49C100D4C),
+  UINT64_C(0x4CC5D4BECB3E42B6), UINT64_C(0x597F299CFC657E2A),
+  UINT64_C(0x5FCB6FAB3AD6FAEC), UINT64_C(0x6C44198C4A475817),
+  };
+
+#define  SHR(x, n) ((x) >> (n))
+#define ROTR(x, n) (SHR((x), (n)) | ((x) << (64 - (n))))
+
+#define S0(x) (ROTR(x, 1) ^ ROTR(x, 8) ^  SHR(x, 7))
+#define S1(x) (ROTR(x, 19) ^ ROTR(x, 61) ^  SHR(x, 6))
+
+#define S2(x) (ROTR(x, 28) ^ ROTR(x, 34) ^ ROTR(x, 39))
+#define S3(x) (ROTR(x, 14) ^ ROTR(x, 18) ^ ROTR(x, 41))
+
+#define F0(x, y, z) (((x) & (y)) | ((z) & ((x) | (y))))
+#define F1(x, y, z) ((z) ^ ((x) & ((y) ^ (z))))
+
+#define P(a, b, c, d, e, f, g, h, x, K)                                      \
+do                                                                           \
+{                                                                            \
+  local.temp1 = (h) + S3(e) + F1((e), (f), (g)) + (K) + (x);                 \
+  local.temp2 = S2(a) + F0((a), (b), (c));                                   \
+  (d) += local.temp1; (h) = local.temp1 + local.temp2;                       \
+} while (0)
+
+static void mbedtls_internal_sha512_process(mbedtls_sha512_context *ctx,
+                                            const unsigned char data[128]) {
+  
+  struct {
+    uint64_t temp1, temp2, W[80];
+    uint64_t A[8];
+  } local;
+  
+  int i;
+  
+  for (i = 0; i < 8; i++) {
+    local.A[i] = ctx->state[i];
+  }
+  
+  for (i = 0; i < 16; i++) {
+    local.W[i] = MBEDTLS_GET_UINT64_BE(data, i << 3);
+  }
+  
+  for (; i < 80; i++) {
+    local.W[i] = S1(local.W[i -  2]) + local.W[i -  7] +
+                 S0(local.W[i - 15]) + local.W[i - 16];
+  }
+  
+  i = 0;
+  do {
+    P(local.A[0], local.A[1], local.A[2], local.A[3], local.A[4],
+      local.A[5], local.A[6], local.A[7], local.W[i], K[i]); i++;
+    P(local.A[7], local.A[0], local.A[1], local.A[2], local.A[3],
+      local.A[4], local.A[5], local.A[6], local.W[i], K[i]); i++;
+    P(local.A[6], local.A[7], local.A[0], local.A[1], local.A[2],
+      local.A[3], local.A[4], local.A[5], local.W[i], K[i]); i++;
+    P(local.A[5], local.A[6], local.A[7], local.A[0], local.A[1],
+      local.A[2], local.A[3], local.A[4], local.W[i], K[i]); i++;
+    P(local.A[4], local.A[5], local.A[6], local.A[7], local.A[0],
+      local.A[1], local.A[2], local.A[3], local.W[i], K[i]); i++;
+    P(local.A[3], local.A[4], local.A[5], local.A[6], local.A[7],
+      local.A[0], local.A[1], local.A[2], local.W[i], K[i]); i++;
+    P(local.A[2], local.A[3], local.A[4], local.A[5], local.A[6],
+      local.A[7], local.A[0], local.A[1], local.W[i], K[i]); i++;
+    P(local.A[1], local.A[2], local.A[3], local.A[4], local.A[5],
+      local.A[6], local.A[7], local.A[0], local.W[i], K[i]); i++;
+  } while (i < 80);
+  
+  for (i = 0; i < 8; i++) {
+    ctx->state[i] += local.A[i];
+  }
+  
+}
+
+static void mbedtls_sha512_update(mbedtls_sha512_context *ctx,
+                                  const unsigned char *input,
+                                  size_t ilen) {
+  
+  size_t fill;
+  unsigned int left;
+  
+  if (ilen == 0) {
+    return;
+  }
+  
+  left = (unsigned int) (ctx->total[0] & 0x7F);
+  fill = SB_SHA512_BLK - left;
+  
+  ctx->total[0] += (uint64_t) ilen;
+  
+  if (ctx->total[0] < (uint64_t) ilen) { ctx->total[1]++; }
+  
+  if (left && ilen >= fill) {
+    memcpy((void *) (ctx->buffer + left), input, fill);
+    mbedtls_internal_sha512_process(ctx, ctx->buffer);
+    input += fill;
+    ilen  -= fill;
+    left = 0;
+  }
+  
+  while (ilen >= SB_SHA512_BLK) {
+    mbedtls_internal_sha512_process(ctx, input);
+    input += SB_SHA512_BLK;
+    ilen  -= SB_SHA512_BLK;
+  }
+  
+  if (ilen > 0) {
+    memcpy((void *) (ctx->buffer + left), input, ilen);
+  }
+  
+}
+
+static void mbedtls_sha512_finish(mbedtls_sha512_context *ctx,
+                                  unsigned char *output) {
+  
+  unsigned char tmp[SB_SHA512_SIZE];
+  unsigned used;
+  uint64_t high, low;
+  
+  used = ctx->total[0] & 0x7F;
+  ctx->buffer[used++] = 0x80;
+  
+  if (used <= 112) {
+    memset(ctx->buffer + used, 0, 112 - used);
+  } else {
+    memset(ctx->buffer + used, 0, SB_SHA512_BLK - used);
+    mbedtls_internal_sha512_process(ctx, ctx->buffer);
+    memset(ctx->buffer, 0, 112);
+  }
+  
+  high = (ctx->total[0] >> 61) | (ctx->total[1] << 3);
+  low  = (ctx->total[0] <<  3);
+  
+  MBEDTLS_PUT_UINT64_BE(high, ctx->buffer, 112);
+  MBEDTLS_PUT_UINT64_BE(low,  ctx->buffer, 120);
+  
+  mbedtls_internal_sha512_process(ctx, ctx->buffer);
+  
+  for (int i = 0; i < 8; i++)
+    MBEDTLS_PUT_UINT64_BE(ctx->state[i], tmp, i << 3);
+  memcpy(output, tmp, ctx->olen);
+  sb_clear_buffer(tmp, SB_SHA512_SIZE);
+  
+}
+
+// secretbase - internals ------------------------------------------------------
+
+static void hash_bytes(void *ctx, const unsigned char *buf, size_t len) {
+  
+  mbedtls_sha512_update((mbedtls_sha512_context *) ctx, buf, len);
+  
+}
+
+static void hash_file(mbedtls_sha512_context *ctx, const SEXP x) {
+  
+  SB_ASSERT_STR(x);
+  const char *file = R_ExpandFileName(CHAR(*STRING_PTR_RO(x)));
+  unsigned char buf[SB_BUF_SIZE];
+  FILE *f;
+  size_t cur;
+  
+  if ((f = fopen(file, "rb")) == NULL)
+    ERROR_FOPEN(file);
+  
+  setbuf(f, NULL);
+  
+  while ((cur = fread(buf, sizeof(char), SB_BUF_SIZE, f))) {
+    mbedtls_sha512_update(ctx, buf, cur);
+  }
+  
+  if (ferror(f)) {
+    fclose(f);
+    ERROR_FREAD(file);
+  }
+  fclose(f);
+  
+}
+
+static void hash_object(mbedtls_sha512_context *ctx, const SEXP x) {
+  
+  switch (TYPEOF(x)) {
+  case STRSXP:
+    if (XLENGTH(x) == 1 && NO_ATTRIB(x)) {
+      const char *s = CHAR(*STRING_PTR_RO(x));
+      mbedtls_sha512_update(ctx, (uint8_t *) s, strlen(s));
+      return;
+    }
+    break;
+  case RAWSXP:
+    if (NO_ATTRIB(x)) {
+      sb_hash_raw(x, ctx, hash_bytes);
+      return;
+    }
+    break;
+  }
+  
+  sb_hash_serial(x, ctx, hash_bytes);
+  
+}
+
+static size_t sb_sha512_olen(const SEXP bits) {
+  
+  const int bt = sb_integer(bits);
+  if (bt != 512 && bt != 384 && bt != 256)
+    Rf_error("'bits' must be 256, 384 or 512");
+  
+  return (size_t) bt / 8;
+  
+}
+
+static void sb_sha512_hmac_init(mbedtls_sha512_context *ictx,
+                                mbedtls_sha512_context *octx, const SEXP key,
+                                const size_t olen) {
+  
+  size_t klen;
+  unsigned char sum[SB_SHA512_BLK], ipad[SB_SHA512_BLK], opad[SB_SHA512_BLK];
+  memset(sum, 0, SB_SHA512_BLK);
+  unsigned char *data;
+  
+  switch (TYPEOF(key)) {
+  case STRSXP:
+    data = (unsigned char *) (XLENGTH(key) ? CHAR(*STRING_PTR_RO(key)) : "");
+    klen = strlen((char *) data);
+    break;
+  case RAWSXP:
+    data = (unsigned char *) DATAPTR_RO(key);
+    klen = XLENGTH(key);
+    break;
+  default:
+    Rf_error("'key' must be a character string, raw vector or NULL");
+  }
+  
+  if (klen > SB_SHA512_BLK) {
+    mbedtls_sha512_init(ictx);
+    mbedtls_sha512_starts(ictx, olen);
+    mbedtls_sha512_update(ictx, data, klen);
+    mbedtls_sha512_finish(ictx, sum);
+  } else {
+    memcpy(sum, data, klen);
+  }
+  
+  for (int i = 0; i < SB_SHA512_BLK; i++) {
+    ipad[i] = sum[i] ^ 0x36;
+    opad[i] = sum[i] ^ 0x5C;
+  }
+  
+  mbedtls_sha512_init(ictx);
+  mbedtls_sha512_starts(ictx, olen);
+  mbedtls_sha512_update(ictx, ipad, SB_SHA512_BLK);
+  mbedtls_sha512_init(octx);
+  mbedtls_sha512_starts(octx, olen);
+  mbedtls_sha512_update(octx, opad, SB_SHA512_BLK);
+  
+  sb_clear_buffer(sum, SB_SHA512_BLK);
+  sb_clear_buffer(ipad, SB_SHA512_BLK);
+  sb_clear_buffer(opad, SB_SHA512_BLK);
+  
+}
+
+static SEXP secretbase_sha512_impl(const SEXP x, const SEXP bits, const SEXP key,
+                                   const SEXP convert,
+                                   void (*const hash_func)(mbedtls_sha512_context *, SEXP)) {
+  
+  SB_ASSERT_LOGICAL(convert);
+  const int conv = SB_LOGICAL(convert);
+  const size_t olen = sb_sha512_olen(bits);
+  unsigned char buf[SB_SHA512_SIZE];
+  mbedtls_sha512_context ctx;
+  
+  if (key == R_NilValue) {
+  
+    mbedtls_sha512_init(&ctx);
+    mbedtls_sha512_starts(&ctx, olen);
+    hash_func(&ctx, x);
+    mbedtls_sha512_finish(&ctx, buf);
+  
+  } else {
+  
+    mbedtls_sha512_context octx;
+    sb_sha512_hmac_init(&ctx, &octx, key, olen);
+    hash_func(&ctx, x);
+    mbedtls_sha512_finish(&ctx, buf);
+    mbedtls_sha512_update(&octx, buf, olen);
+    mbedtls_sha512_finish(&octx, buf);
+    sb_clear_buffer(&octx, sizeof(mbedtls_sha512_context));
+  
+  }
+  
+  sb_clear_buffer(&ctx, sizeof(mbedtls_sha512_context));
+  
+  return sb_hash_sexp(buf, olen, conv);
+  
+}
+
+// secretbase - exported functions ---------------------------------------------
+
+SEXP secretbase_sha512(SEXP x, SEXP bits, SEXP key, SEXP convert) {
+  
+  return secretbase_sha512_impl(x, bits, key, convert, hash_object);
+  
+}
+
+SEXP secretbase_sha512_file(SEXP x, SEXP bits, SEXP key, SEXP convert) {
+  
+  return secretbase_sha512_impl(x, bits, key, convert, hash_file);
+  
+}
@@ -171,11 +171,9 @@ static inline uint64_t c_siphash_finalize(CSipHash *state) {
 
 // secretbase - internals ------------------------------------------------------
 
-static inline void hash_bytes(R_outpstream_t stream, void *src, int len) {
+static void hash_bytes(void *ctx, const unsigned char *buf, size_t len) {
   
-  secretbase_context *sctx = (secretbase_context *) stream->data;
-  sctx->skip ? (void) sctx->skip-- :
-    c_siphash_append((CSipHash *) sctx->ctx, (uint8_t *) src, (size_t) len);
+  c_siphash_append((CSipHash *) ctx, buf, len);
   
 }
 
@@ -214,41 +212,20 @@ static void hash_object(CSipHash *ctx, const SEXP x) {
     break;
   case RAWSXP:
     if (NO_ATTRIB(x)) {
-      c_siphash_append(ctx, (uint8_t *) DATAPTR_RO(x), (size_t) XLENGTH(x));
+      sb_hash_raw(x, ctx, hash_bytes);
       return;
     }
     break;
   }
   
-  secretbase_context sctx;
-  sctx.skip = SB_SERIAL_HEADERS;
-  sctx.ctx = ctx;
-  
-  struct R_outpstream_st output_stream;
-  R_InitOutPStream(
-    &output_stream,
-    (R_pstream_data_t) &sctx,
-    R_pstream_xdr_format,
-    SB_R_SERIAL_VER,
-    NULL,
-    hash_bytes,
-    NULL,
-    R_NilValue
-  );
-  R_Serialize(x, &output_stream);
+  sb_hash_serial(x, ctx, hash_bytes);
   
 }
 
-static SEXP secretbase_siphash_impl(const SEXP x, const SEXP key, const SEXP convert,
-                                    void (*const hash_func)(CSipHash *, SEXP)) {
-  
-  SB_ASSERT_LOGICAL(convert);
-  const int conv = SB_LOGICAL(convert);
-  uint64_t hash;
+static void sb_siphash_init(CSipHash *ctx, const SEXP key) {
   
-  CSipHash ctx;
   if (key == R_NilValue) {
-    c_siphash_init_nokey(&ctx);
+    c_siphash_init_nokey(ctx);
   } else {
     uint8_t seed[SB_SKEY_SIZE];
     memset(seed, 0, SB_SKEY_SIZE);
@@ -267,8 +244,20 @@ static SEXP secretbase_siphash_impl(const SEXP x, const SEXP key, const SEXP con
       Rf_error("'key' must be a character string, raw vector or NULL");
     }
     memcpy(seed, data, klen < SB_SKEY_SIZE ? klen : SB_SKEY_SIZE);
-    c_siphash_init(&ctx, seed);
+    c_siphash_init(ctx, seed);
   }
+  
+}
+
+static SEXP secretbase_siphash_impl(const SEXP x, const SEXP key, const SEXP convert,
+                                    void (*const hash_func)(CSipHash *, SEXP)) {
+  
+  SB_ASSERT_LOGICAL(convert);
+  const int conv = SB_LOGICAL(convert);
+  uint64_t hash;
+  
+  CSipHash ctx;
+  sb_siphash_init(&ctx, key);
   hash_func(&ctx, x);
   hash = c_siphash_finalize(&ctx);
   
@@ -276,6 +265,44 @@ static SEXP secretbase_siphash_impl(const SEXP x, const SEXP key, const SEXP con
   
 }
 
+// secretbase - hashing contexts -----------------------------------------------
+
+static const char * siphash13_ctx_init(void *ctx, const SEXP bits, const SEXP key, size_t *size) {
+  
+  (void) bits;
+  sb_siphash_init((CSipHash *) ctx, key);
+  *size = SB_SIPH_SIZE;
+  
+  return "SipHash-1-3";
+  
+}
+
+static void siphash13_ctx_update(void *ctx, const unsigned char *buf, size_t len) {
+  
+  c_siphash_append((CSipHash *) ctx, buf, len);
+  
+}
+
+static void siphash13_ctx_digest(const void *ctx, unsigned char *out) {
+  
+  CSipHash c = *(const CSipHash *) ctx;
+  const uint64_t hash = c_siphash_finalize(&c);
+  memcpy(out, &hash, SB_SIPH_SIZE);
+  
+}
+
+static int siphash13_ctx_check(const void *ctx, size_t size) {
+  
+  (void) ctx;
+  return size == SB_SIPH_SIZE;
+  
+}
+
+const sb_hash_ops sb_siphash13_ops = {
+  sizeof(CSipHash), siphash13_ctx_init, siphash13_ctx_update, siphash13_ctx_digest,
+  siphash13_ctx_check
+};
+
 // secretbase - exported functions ---------------------------------------------
 
 SEXP secretbase_siphash13(SEXP x, SEXP key, SEXP convert) {
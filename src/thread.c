@@ -0,0 +1,286 @@
+// secretbase ------------------------------------------------------------------
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include "secret.h"
+
+// secretbase - native worker threads ------------------------------------------
+
+/*
+ *  Data-parallel work is split into independent tasks, which are claimed in
+ *  order by the worker threads and the calling thread alike. Workers are
+ *  started for each call and never touch the R API, so tasks may only read
+ *  and write memory prepared by the caller. If a worker cannot be started,
+ *  its share of the tasks is simply run by the remaining threads.
+ *
+ *  A single thread is used unless more are requested through threads() or
+ *  the SECRETBASE_THREADS environment variable.
+ */
+
+#define SB_MAX_THREADS 64
+
+typedef struct sb_parallel_ctx {
+  void (*func)(void *, size_t);
+  void *arg;
+  size_t n;
+  size_t next;
+  pthread_mutex_t mtx;
+} sb_parallel_ctx;
+
+static int sb_nthreads = 1;
+
+void sb_threads_init(void) {
+  
+  const char *env = getenv("SECRETBASE_THREADS");
+  const int n = env != NULL ? atoi(env) : 0;
+  sb_nthreads = n > 0 ? (n > SB_MAX_THREADS ? SB_MAX_THREADS : n) : 1;
+  
+}
+
+int sb_threads(void) {
+  
+  return sb_nthreads;
+  
+}
+
+static void * sb_parallel_worker(void *arg) {
+  
+  sb_parallel_ctx *ctx = (sb_parallel_ctx *) arg;
+  size_t i;
+  
+  for (;;) {
+    pthread_mutex_lock(&ctx->mtx);
+    i = ctx->next++;
+    pthread_mutex_unlock(&ctx->mtx);
+    if (i >= ctx->n)
+      break;
+    ctx->func(ctx->arg, i);
+  }
+  
+  return NULL;
+  
+}
+
+void sb_parallel(void (*func)(void *, size_t), void *arg, const size_t n) {
+  
+  size_t nworkers = (size_t) sb_nthreads - 1;
+  if (n <= 1)
+    nworkers = 0;
+  else if (nworkers > n - 1)
+    nworkers = n - 1;
+  
+  if (nworkers == 0) {
+    for (size_t i = 0; i < n; i++)
+      func(arg, i);
+    return;
+  }
+  
+  pthread_t tid[SB_MAX_THREADS];
+  int started[SB_MAX_THREADS];
+  sb_parallel_ctx ctx;
+  ctx.func = func;
+  ctx.arg = arg;
+  ctx.n = n;
+  ctx.next = 0;
+  pthread_mutex_init(&ctx.mtx, NULL);
+  
+  for (size_t i = 0; i < nworkers; i++)
+    started[i] = pthread_create(&tid[i], NULL, sb_parallel_worker, &ctx) == 0;
+  
+  sb_parallel_worker(&ctx);
+  
+  for (size_t i = 0; i < nworkers; i++) {
+    if (started[i])
+      pthread_join(tid[i], NULL);
+  }
+  pthread_mutex_destroy(&ctx.mtx);
+  
+}
+
+// secretbase - serialization pipeline -----------------------------------------
+
+/*
+ *  Overlaps serialization on the calling thread with hashing on a worker.
+ *  The calling thread copies serialized bytes into a ring of fixed-size
+ *  blocks, and the worker applies the update function to each full block in
+ *  turn. Blocks are handed over lock-free through the head (blocks written)
+ *  and tail (blocks hashed) counters, each advanced by one side only. A side
+ *  that finds the ring full or empty spins briefly, then sleeps on the
+ *  condition variable until woken by the other.
+ */
+
+#define SB_PIPE_SLOTS 8
+#define SB_PIPE_BLOCK SB_BUF_SIZE
+#define SB_PIPE_SPIN 4096
+
+struct sb_pipe {
+  void *ctx;
+  void (*update)(void *, const unsigned char *, size_t);
+  unsigned char *buf;
+  size_t len[SB_PIPE_SLOTS];
+  size_t fill;
+  atomic_size_t head;
+  atomic_size_t tail;
+  atomic_int done;
+  atomic_int waiting[2];
+  pthread_mutex_t mtx;
+  pthread_cond_t cond;
+  pthread_t tid;
+};
+
+/* sleeps until ready() holds, as the consumer (0) or producer (1) */
+static void sb_pipe_wait(sb_pipe *p, const int who, int (*ready)(sb_pipe *)) {
+  
+  for (int i = 0; i < SB_PIPE_SPIN; i++) {
+    if (ready(p))
+      return;
+  }
+  
+  pthread_mutex_lock(&p->mtx);
+  atomic_store(&p->waiting[who], 1);
+  while (!ready(p))
+    pthread_cond_wait(&p->cond, &p->mtx);
+  atomic_store(&p->waiting[who], 0);
+  pthread_mutex_unlock(&p->mtx);
+  
+}
+
+static void sb_pipe_wake(sb_pipe *p, const int who) {
+  
+  if (atomic_load(&p->waiting[who])) {
+    pthread_mutex_lock(&p->mtx);
+    pthread_cond_broadcast(&p->cond);
+    pthread_mutex_unlock(&p->mtx);
+  }
+  
+}
+
+static int sb_pipe_readable(sb_pipe *p) {
+  
+  return atomic_load(&p->head) != atomic_load_explicit(&p->tail, memory_order_relaxed) ||
+    atomic_load(&p->done);
+  
+}
+
+static int sb_pipe_writable(sb_pipe *p) {
+  
+  return atomic_load_explicit(&p->head, memory_order_relaxed) - atomic_load(&p->tail) < SB_PIPE_SLOTS;
+  
+}
+
+static void * sb_pipe_worker(void *arg) {
+  
+  sb_pipe *p = (sb_pipe *) arg;
+  size_t tail = 0;
+  
+  for (;;) {
+    if (atomic_load(&p->head) == tail) {
+      if (atomic_load(&p->done)) {
+        if (atomic_load(&p->head) == tail)
+          break;
+        continue;
+      }
+      sb_pipe_wait(p, 0, sb_pipe_readable);
+      continue;
+    }
+    const size_t slot = tail % SB_PIPE_SLOTS;
+    p->update(p->ctx, p->buf + slot * SB_PIPE_BLOCK, p->len[slot]);
+    atomic_store(&p->tail, ++tail);
+    sb_pipe_wake(p, 1);
+  }
+  
+  return NULL;
+  
+}
+
+static void sb_pipe_publish(sb_pipe *p) {
+  
+  const size_t head = atomic_load_explicit(&p->head, memory_order_relaxed);
+  p->len[head % SB_PIPE_SLOTS] = p->fill;
+  p->fill = 0;
+  atomic_store(&p->head, head + 1);
+  sb_pipe_wake(p, 0);
+  
+}
+
+/* returns NULL if the worker cannot be started */
+sb_pipe * sb_pipe_start(void *ctx, void (*update)(void *, const unsigned char *, size_t)) {
+  
+  sb_pipe *p = malloc(sizeof(sb_pipe));
+  if (p == NULL)
+    return NULL;
+  if ((p->buf = malloc(SB_PIPE_SLOTS * SB_PIPE_BLOCK)) == NULL) {
+    free(p);
+    return NULL;
+  }
+  p->ctx = ctx;
+  p->update = update;
+  p->fill = 0;
+  atomic_init(&p->head, 0);
+  atomic_init(&p->tail, 0);
+  atomic_init(&p->done, 0);
+  atomic_init(&p->waiting[0], 0);
+  atomic_init(&p->waiting[1], 0);
+  pthread_mutex_init(&p->mtx, NULL);
+  pthread_cond_init(&p->cond, NULL);
+  
+  if (pthread_create(&p->tid, NULL, sb_pipe_worker, p)) {
+    pthread_cond_destroy(&p->cond);
+    pthread_mutex_destroy(&p->mtx);
+    free(p->buf);
+    free(p);
+    return NULL;
+  }
+  
+  return p;
+  
+}
+
+void sb_pipe_write(sb_pipe *p, const unsigned char *src, size_t n) {
+  
+  while (n) {
+    if (p->fill == 0 && !sb_pipe_writable(p))
+      sb_pipe_wait(p, 1, sb_pipe_writable);
+    const size_t slot = atomic_load_explicit(&p->head, memory_order_relaxed) % SB_PIPE_SLOTS;
+    const size_t cur = n < SB_PIPE_BLOCK - p->fill ? n : SB_PIPE_BLOCK - p->fill;
+    memcpy(p->buf + slot * SB_PIPE_BLOCK + p->fill, src, cur);
+    p->fill += cur;
+    src += cur;
+    n -= cur;
+    if (p->fill == SB_PIPE_BLOCK)
+      sb_pipe_publish(p);
+  }
+  
+}
+
+/* hashes any remaining bytes, then stops the worker and frees the pipe */
+void sb_pipe_finish(sb_pipe *p) {
+  
+  if (p->fill)
+    sb_pipe_publish(p);
+  atomic_store(&p->done, 1);
+  sb_pipe_wake(p, 0);
+  pthread_join(p->tid, NULL);
+  
+  pthread_cond_destroy(&p->cond);
+  pthread_mutex_destroy(&p->mtx);
+  free(p->buf);
+  free(p);
+  
+}
+
+// secretbase - exported functions ---------------------------------------------
+
+SEXP secretbase_threads(SEXP n) {
+  
+  if (n != R_NilValue) {
+    const int nt = (TYPEOF(n) == INTSXP || TYPEOF(n) == REALSXP) && XLENGTH(n) == 1 ?
+      Rf_asInteger(n) : NA_INTEGER;
+    if (nt == NA_INTEGER || nt < 1)
+      Rf_error("'n' must be a positive integer");
+    sb_nthreads = nt > SB_MAX_THREADS ? SB_MAX_THREADS : nt;
+  }
+  
+  return Rf_ScalarInteger(sb_nthreads);
+  
+}
@@ -0,0 +1,778 @@
+// secretbase ------------------------------------------------------------------
+
+#include "secret.h"
+
+// secretbase - xxh3 implementation --------------------------------------------
+
+/*
+ *  XXH3 implementation based on xxHash - Extremely Fast Hash algorithm
+ *
+ *  Copyright (C) 2012-2023 Yann Collet
+ *  SPDX-License-Identifier: BSD-2-Clause
+ */
+/*
+ *  The XXH3 algorithm is described at
+ *
+ *  https://github.com/Cyan4973/xxHash/blob/dev/doc/xxhash_spec.md
+ */
+
+#define XXH_PRIME32_1 0x9E3779B1U
+#define XXH_PRIME32_2 0x85EBCA77U
+#define XXH_PRIME32_3 0xC2B2AE3DU
+#define XXH_PRIME64_1 0x9E3779B185EBCA87ULL
+#define XXH_PRIME64_2 0xC2B2AE3D27D4EB4FULL
+#define XXH_PRIME64_3 0x165667B19E3779F9ULL
+#define XXH_PRIME64_4 0x85EBCA77C2B2AE63ULL
+#define XXH_PRIME64_5 0x27D4EB2F165667C5ULL
+#define XXH_PRIME_MX1 0x165667919E3779F9ULL
+#define XXH_PRIME_MX2 0x9FB21C651E98DF25ULL
+
+#define XXH_STRIPE_LEN 64
+#define XXH_SECRET_CONSUME_RATE 8
+#define XXH_STRIPES_PER_BLOCK ((XXH3_SECRET_SIZE - XXH_STRIPE_LEN) / XXH_SECRET_CONSUME_RATE)
+#define XXH3_MIDSIZE_MAX 240
+#define XXH3_MIDSIZE_STARTOFFSET 3
+#define XXH3_MIDSIZE_LASTOFFSET 17
+#define XXH_SECRET_LASTACC_START 7
+#define XXH_SECRET_MERGEACCS_START 11
+
+static const uint8_t XXH3_kSecret[XXH3_SECRET_SIZE] = {
+  0xb8, 0xfe, 0x6c, 0x39, 0x23, 0xa4, 0x4b, 0xbe, 0x7c, 0x01, 0x81, 0x2c, 0xf7, 0x21, 0xad, 0x1c,
+  0xde, 0xd4, 0x6d, 0xe9, 0x83, 0x90, 0x97, 0xdb, 0x72, 0x40, 0xa4, 0xa4, 0xb7, 0xb3, 0x67, 0x1f,
+  0xcb, 0x79, 0xe6, 0x4e, 0xcc, 0xc0, 0xe5, 0x78, 0x82, 0x5a, 0xd0, 0x7d, 0xcc, 0xff, 0x72, 0x21,
+  0xb8, 0x08, 0x46, 0x74, 0xf7, 0x43, 0x24, 0x8e, 0xe0, 0x35, 0x90, 0xe6, 0x81, 0x3a, 0x26, 0x4c,
+  0x3c, 0x28, 0x52, 0xbb, 0x91, 0xc3, 0x00, 0xcb, 0x88, 0xd0, 0x65, 0x8b, 0x1b, 0x53, 0x2e, 0xa3,
+  0x71, 0x64, 0x48, 0x97, 0xa2, 0x0d, 0xf9, 0x4e, 0x38, 0x19, 0xef, 0x46, 0xa9, 0xde, 0xac, 0xd8,
+  0xa8, 0xfa, 0x76, 0x3f, 0xe3, 0x9c, 0x34, 0x3f, 0xf9, 0xdc, 0xbb, 0xc7, 0xc7, 0x0b, 0x4f, 0x1d,
+  0x8a, 0x51, 0xe0, 0x4b, 0xcd, 0xb4, 0x59, 0x31, 0xc8, 0x9f, 0x7e, 0xc9, 0xd9, 0x78, 0x73, 0x64,
+  0xea, 0xc5, 0xac, 0x83, 0x34, 0xd3, 0xeb, 0xc3, 0xc5, 0x81, 0xa0, 0xff, 0xfa, 0x13, 0x63, 0xeb,
+  0x17, 0x0d, 0xdd, 0x51, 0xb7, 0xf0, 0xda, 0x49, 0xd3, 0x16, 0x55, 0x26, 0x29, 0xd4, 0x68, 0x9e,
+  0x2b, 0x16, 0xbe, 0x58, 0x7d, 0x47, 0xa1, 0xfc, 0x8f, 0xf8, 0xb8, 0xd1, 0x7a, 0xd0, 0x31, 0xce,
+  0x45, 0xcb, 0x3a, 0x8f, 0x95, 0x16, 0x04, 0x28, 0xaf, 0xd7, 0xfb, 0xca, 0xbb, 0x4b, 0x40, 0x7e
+};
+
+typedef struct XXH128_hash {
+  uint64_t low64;
+  uint64_t high64;
+} XXH128_hash;
+
+static inline uint32_t XXH_read32(const uint8_t *p) {
+  return (uint32_t) p[0] | ((uint32_t) p[1] << 8) | ((uint32_t) p[2] << 16) | ((uint32_t) p[3] << 24);
+}
+
+static inline uint64_t XXH_read64(const uint8_t *p) {
+  return MBEDTLS_GET_UINT64_LE(p, 0);
+}
+
+static inline void XXH_write64(uint8_t *p, uint64_t v) {
+  MBEDTLS_PUT_UINT64_LE(v, p, 0);
+}
+
+static inline uint64_t XXH_rotl64(uint64_t x, int r) {
+  return (x << r) | (x >> (64 - r));
+}
+
+static inline uint32_t XXH_rotl32(uint32_t x, int r) {
+  return (x << r) | (x >> (32 - r));
+}
+
+static inline uint64_t XXH_mult32to64(uint64_t x, uint64_t y) {
+  return (uint64_t) (uint32_t) x * (uint64_t) (uint32_t) y;
+}
+
+static inline XXH128_hash XXH_mult64to128(uint64_t lhs, uint64_t rhs) {
+  
+  XXH128_hash r128;
+#if defined(__SIZEOF_INT128__)
+  const __uint128_t product = (__uint128_t) lhs * (__uint128_t) rhs;
+  r128.low64 = (uint64_t) product;
+  r128.high64 = (uint64_t) (product >> 64);
+#else
+  const uint64_t lo_lo = XXH_mult32to64(lhs & 0xFFFFFFFF, rhs & 0xFFFFFFFF);
+  const uint64_t hi_lo = XXH_mult32to64(lhs >> 32, rhs & 0xFFFFFFFF);
+  const uint64_t lo_hi = XXH_mult32to64(lhs & 0xFFFFFFFF, rhs >> 32);
+  const uint64_t hi_hi = XXH_mult32to64(lhs >> 32, rhs >> 32);
+  const uint64_t cross = (lo_lo >> 32) + (hi_lo & 0xFFFFFFFF) + lo_hi;
+  r128.low64 = (cross << 32) | (lo_lo & 0xFFFFFFFF);
+  r128.high64 = (hi_lo >> 32) + (cross >> 32) + hi_hi;
+#endif
+  return r128;
+  
+}
+
+static inline uint64_t XXH3_mul128_fold64(uint64_t lhs, uint64_t rhs) {
+  const XXH128_hash product = XXH_mult64to128(lhs, rhs);
+  return product.low64 ^ product.high64;
+}
+
+static inline uint64_t XXH_xorshift64(uint64_t v64, int shift) {
+  return v64 ^ (v64 >> shift);
+}
+
+static inline uint64_t XXH64_avalanche(uint64_t h64) {
+  h64 ^= h64 >> 33;
+  h64 *= XXH_PRIME64_2;
+  h64 ^= h64 >> 29;
+  h64 *= XXH_PRIME64_3;
+  h64 ^= h64 >> 32;
+  return h64;
+}
+
+static inline uint64_t XXH3_avalanche(uint64_t h64) {
+  h64 = XXH_xorshift64(h64, 37);
+  h64 *= XXH_PRIME_MX1;
+  h64 = XXH_xorshift64(h64, 32);
+  return h64;
+}
+
+static inline uint64_t XXH3_rrmxmx(uint64_t h64, uint64_t len) {
+  h64 ^= XXH_rotl64(h64, 49) ^ XXH_rotl64(h64, 24);
+  h64 *= XXH_PRIME_MX2;
+  h64 ^= (h64 >> 35) + len;
+  h64 *= XXH_PRIME_MX2;
+  return XXH_xorshift64(h64, 28);
+}
+
+// secretbase - xxh3 short inputs (up to 240 bytes) ----------------------------
+
+static inline uint64_t XXH3_mix16B(const uint8_t *input, const uint8_t *secret, uint64_t seed) {
+  const uint64_t input_lo = XXH_read64(input);
+  const uint64_t input_hi = XXH_read64(input + 8);
+  return XXH3_mul128_fold64(input_lo ^ (XXH_read64(secret) + seed),
+                            input_hi ^ (XXH_read64(secret + 8) - seed));
+}
+
+static uint64_t XXH3_len_0to16_64b(const uint8_t *input, size_t len,
+                                   const uint8_t *secret, uint64_t seed) {
+  
+  if (len > 8) {
+    const uint64_t bitflip1 = (XXH_read64(secret + 24) ^ XXH_read64(secret + 32)) + seed;
+    const uint64_t bitflip2 = (XXH_read64(secret + 40) ^ XXH_read64(secret + 48)) - seed;
+    const uint64_t input_lo = XXH_read64(input) ^ bitflip1;
+    const uint64_t input_hi = XXH_read64(input + len - 8) ^ bitflip2;
+    const uint64_t acc = len + MBEDTLS_BSWAP64(input_lo) + input_hi +
+      XXH3_mul128_fold64(input_lo, input_hi);
+    return XXH3_avalanche(acc);
+  }
+  if (len >= 4) {
+    seed ^= (uint64_t) MBEDTLS_BSWAP32((uint32_t) seed) << 32;
+    const uint32_t input1 = XXH_read32(input);
+    const uint32_t input2 = XXH_read32(input + len - 4);
+    const uint64_t bitflip = (XXH_read64(secret + 8) ^ XXH_read64(secret + 16)) - seed;
+    const uint64_t input64 = input2 + (((uint64_t) input1) << 32);
+    return XXH3_rrmxmx(input64 ^ bitflip, len);
+  }
+  if (len) {
+    const uint8_t c1 = input[0];
+    const uint8_t c2 = input[len >> 1];
+    const uint8_t c3 = input[len - 1];
+    const uint32_t combined = ((uint32_t) c1 << 16) | ((uint32_t) c2 << 24) |
+      ((uint32_t) c3 << 0) | ((uint32_t) len << 8);
+    const uint64_t bitflip = (XXH_read32(secret) ^ XXH_read32(secret + 4)) + seed;
+    return XXH64_avalanche((uint64_t) combined ^ bitflip);
+  }
+  return XXH64_avalanche(seed ^ (XXH_read64(secret + 56) ^ XXH_read64(secret + 64)));
+  
+}
+
+static uint64_t XXH3_len_17to128_64b(const uint8_t *input, size_t len,
+                                     const uint8_t *secret, uint64_t seed) {
+  
+  uint64_t acc = len * XXH_PRIME64_1;
+  if (len > 32) {
+    if (len > 64) {
+      if (len > 96) {
+        acc += XXH3_mix16B(input + 48, secret + 96, seed);
+        acc += XXH3_mix16B(input + len - 64, secret + 112, seed);
+      }
+      acc += XXH3_mix16B(input + 32, secret + 64, seed);
+      acc += XXH3_mix16B(input + len - 48, secret + 80, seed);
+    }
+    acc += XXH3_mix16B(input + 16, secret + 32, seed);
+    acc += XXH3_mix16B(input + len - 32, secret + 48, seed);
+  }
+  acc += XXH3_mix16B(input + 0, secret + 0, seed);
+  acc += XXH3_mix16B(input + len - 16, secret + 16, seed);
+  return XXH3_avalanche(acc);
+  
+}
+
+static uint64_t XXH3_len_129to240_64b(const uint8_t *input, size_t len,
+                                      const uint8_t *secret, uint64_t seed) {
+  
+  uint64_t acc = len * XXH_PRIME64_1;
+  const size_t nbRounds = len / 16;
+  for (size_t i = 0; i < 8; i++)
+    acc += XXH3_mix16B(input + (16 * i), secret + (16 * i), seed);
+  acc = XXH3_avalanche(acc);
+  for (size_t i = 8; i < nbRounds; i++)
+    acc += XXH3_mix16B(input + (16 * i), secret + (16 * (i - 8)) + XXH3_MIDSIZE_STARTOFFSET, seed);
+  acc += XXH3_mix16B(input + len - 16,
+                     secret + XXH3_SECRET_SIZE_MIN - XXH3_MIDSIZE_LASTOFFSET, seed);
+  return XXH3_avalanche(acc);
+  
+}
+
+static XXH128_hash XXH3_len_0to16_128b(const uint8_t *input, size_t len,
+                                       const uint8_t *secret, uint64_t seed) {
+  
+  XXH128_hash h128;
+  if (len > 8) {
+    const uint64_t bitflipl = (XXH_read64(secret + 32) ^ XXH_read64(secret + 40)) - seed;
+    const uint64_t bitfliph = (XXH_read64(secret + 48) ^ XXH_read64(secret + 56)) + seed;
+    const uint64_t input_lo = XXH_read64(input);
+    uint64_t input_hi = XXH_read64(input + len - 8);
+    XXH128_hash m128 = XXH_mult64to128(input_lo ^ input_hi ^ bitflipl, XXH_PRIME64_1);
+    m128.low64 += (uint64_t) (len - 1) << 54;
+    input_hi ^= bitfliph;
+    m128.high64 += input_hi + XXH_mult32to64((uint32_t) input_hi, XXH_PRIME32_2 - 1);
+    m128.low64 ^= MBEDTLS_BSWAP64(m128.high64);
+    h128 = XXH_mult64to128(m128.low64, XXH_PRIME64_2);
+    h128.high64 += m128.high64 * XXH_PRIME64_2;
+    h128.low64 = XXH3_avalanche(h128.low64);
+    h128.high64 = XXH3_avalanche(h128.high64);
+    return h128;
+  }
+  if (len >= 4) {
+    seed ^= (uint64_t) MBEDTLS_BSWAP32((uint32_t) seed) << 32;
+    const uint32_t input_lo = XXH_read32(input);
+    const uint32_t input_hi = XXH_read32(input + len - 4);
+    const uint64_t input_64 = input_lo + ((uint64_t) input_hi << 32);
+    const uint64_t bitflip = (XXH_read64(secret + 16) ^ XXH_read64(secret + 24)) + seed;
+    const uint64_t keyed = input_64 ^ bitflip;
+    XXH128_hash m128 = XXH_mult64to128(keyed, XXH_PRIME64_1 + (len << 2));
+    m128.high64 += (m128.low64 << 1);
+    m128.low64 ^= (m128.high64 >> 3);
+    m128.low64 = XXH_xorshift64(m128.low64, 35);
+    m128.low64 *= XXH_PRIME_MX2;
+    m128.low64 = XXH_xorshift64(m128.low64, 28);
+    m128.high64 = XXH3_avalanche(m128.high64);
+    return m128;
+  }
+  if (len) {
+    const uint8_t c1 = input[0];
+    const uint8_t c2 = input[len >> 1];
+    const uint8_t c3 = input[len - 1];
+    const uint32_t combinedl = ((uint32_t) c1 << 16) | ((uint32_t) c2 << 24) |
+      ((uint32_t) c3 << 0) | ((uint32_t) len << 8);
+    const uint32_t combinedh = XXH_rotl32(MBEDTLS_BSWAP32(combinedl), 13);
+    const uint64_t bitflipl = (XXH_read32(secret) ^ XXH_read32(secret + 4)) + seed;
+    const uint64_t bitfliph = (XXH_read32(secret + 8) ^ XXH_read32(secret + 12)) - seed;
+    h128.low64 = XXH64_avalanche((uint64_t) combinedl ^ bitflipl);
+    h128.high64 = XXH64_avalanche((uint64_t) combinedh ^ bitfliph);
+    return h128;
+  }
+  h128.low64 = XXH64_avalanche(seed ^ (XXH_read64(secret + 64) ^ XXH_read64(secret + 72)));
+  h128.high64 = XXH64_avalanche(seed ^ (XXH_read64(secret + 80) ^ XXH_read64(secret + 88)));
+  return h128;
+  
+}
+
+static inline XXH128_hash XXH128_mix32B(XXH128_hash acc, const uint8_t *input_1,
+                                        const uint8_t *input_2, const uint8_t *secret,
+                                        uint64_t seed) {
+  acc.low64 += XXH3_mix16B(input_1, secret + 0, seed);
+  acc.low64 ^= XXH_read64(input_2) + XXH_read64(input_2 + 8);
+  acc.high64 += XXH3_mix16B(input_2, secret + 16, seed);
+  acc.high64 ^= XXH_read64(input_1) + XXH_read64(input_1 + 8);
+  return acc;
+}
+
+static inline XXH128_hash XXH128_finalize_mid(XXH128_hash acc, size_t len, uint64_t seed) {
+  XXH128_hash h128;
+  h128.low64 = acc.low64 + acc.high64;
+  h128.high64 = (acc.low64 * XXH_PRIME64_1) + (acc.high64 * XXH_PRIME64_4) +
+    ((len - seed) * XXH_PRIME64_2);
+  h128.low64 = XXH3_avalanche(h128.low64);
+  h128.high64 = (uint64_t) 0 - XXH3_avalanche(h128.high64);
+  return h128;
+}
+
+static XXH128_hash XXH3_len_17to128_128b(const uint8_t *input, size_t len,
+                                         const uint8_t *secret, uint64_t seed) {
+  
+  XXH128_hash acc;
+  acc.low64 = len * XXH_PRIME64_1;
+  acc.high64 = 0;
+  if (len > 32) {
+    if (len > 64) {
+      if (len > 96)
+        acc = XXH128_mix32B(acc, input + 48, input + len - 64, secret + 96, seed);
+      acc = XXH128_mix32B(acc, input + 32, input + len - 48, secret + 64, seed);
+    }
+    acc = XXH128_mix32B(acc, input + 16, input + len - 32, secret + 32, seed);
+  }
+  acc = XXH128_mix32B(acc, input, input + len - 16, secret, seed);
+  return XXH128_finalize_mid(acc, len, seed);
+  
+}
+
+static XXH128_hash XXH3_len_129to240_128b(const uint8_t *input, size_t len,
+                                          const uint8_t *secret, uint64_t seed) {
+  
+  XXH128_hash acc;
+  acc.low64 = len * XXH_PRIME64_1;
+  acc.high64 = 0;
+  size_t i;
+  for (i = 32; i < 160; i += 32)
+    acc = XXH128_mix32B(acc, input + i - 32, input + i - 16, secret + i - 32, seed);
+  acc.low64 = XXH3_avalanche(acc.low64);
+  acc.high64 = XXH3_avalanche(acc.high64);
+  for (i = 160; i <= len; i += 32)
+    acc = XXH128_mix32B(acc, input + i - 32, input + i - 16,
+                        secret + XXH3_MIDSIZE_STARTOFFSET + i - 160, seed);
+  acc = XXH128_mix32B(acc, input + len - 16, input + len - 32,
+                      secret + XXH3_SECRET_SIZE_MIN - XXH3_MIDSIZE_LASTOFFSET - 16,
+                      (uint64_t) 0 - seed);
+  return XXH128_finalize_mid(acc, len, seed);
+  
+}
+
+// secretbase - xxh3 long input kernels ----------------------------------------
+
+/*
+ *  Inputs over 240 bytes are consumed in 64-byte stripes into 8 accumulator
+ *  lanes, which are scrambled after each block of 16 stripes. Both steps have
+ *  SIMD kernels, selected at runtime.
+ */
+
+static void XXH3_accumulate_scalar(uint64_t acc[8], const uint8_t *input,
+                                   const uint8_t *secret, size_t nbStripes) {
+  
+  for (size_t n = 0; n < nbStripes; n++) {
+    const uint8_t *in = input + n * XXH_STRIPE_LEN;
+    const uint8_t *sec = secret + n * XXH_SECRET_CONSUME_RATE;
+    for (size_t i = 0; i < 8; i++) {
+      const uint64_t data_val = XXH_read64(in + 8 * i);
+      const uint64_t data_key = data_val ^ XXH_read64(sec + 8 * i);
+      acc[i ^ 1] += data_val;
+      acc[i] += XXH_mult32to64(data_key & 0xFFFFFFFF, data_key >> 32);
+    }
+  }
+  
+}
+
+static void XXH3_scramble_scalar(uint64_t acc[8], const uint8_t *secret) {
+  
+  for (size_t i = 0; i < 8; i++) {
+    uint64_t acc64 = acc[i];
+    acc64 = XXH_xorshift64(acc64, 47);
+    acc64 ^= XXH_read64(secret + 8 * i);
+    acc64 *= XXH_PRIME32_1;
+    acc[i] = acc64;
+  }
+  
+}
+
+#ifdef SB_X86_SIMD
+
+#include <immintrin.h>
+
+__attribute__((target("sse2")))
+static void XXH3_accumulate_sse2(uint64_t acc[8], const uint8_t *input,
+                                 const uint8_t *secret, size_t nbStripes) {
+  
+  __m128i a[4];
+  for (int i = 0; i < 4; i++)
+    a[i] = _mm_loadu_si128((const __m128i *) (acc + 2 * i));
+  
+  for (size_t n = 0; n < nbStripes; n++) {
+    const uint8_t *in = input + n * XXH_STRIPE_LEN;
+    const uint8_t *sec = secret + n * XXH_SECRET_CONSUME_RATE;
+    for (int i = 0; i < 4; i++) {
+      const __m128i data_vec = _mm_loadu_si128((const __m128i *) (in + 16 * i));
+      const __m128i key_vec = _mm_loadu_si128((const __m128i *) (sec + 16 * i));
+      const __m128i data_key = _mm_xor_si128(data_vec, key_vec);
+      const __m128i data_key_lo = _mm_shuffle_epi32(data_key, _MM_SHUFFLE(0, 3, 0, 1));
+      const __m128i product = _mm_mul_epu32(data_key, data_key_lo);
+      const __m128i data_swap = _mm_shuffle_epi32(data_vec, _MM_SHUFFLE(1, 0, 3, 2));
+      a[i] = _mm_add_epi64(product, _mm_add_epi64(a[i], data_swap));
+    }
+  }
+  
+  for (int i = 0; i < 4; i++)
+    _mm_storeu_si128((__m128i *) (acc + 2 * i), a[i]);
+  
+}
+
+__attribute__((target("sse2")))
+static void XXH3_scramble_sse2(uint64_t acc[8], const uint8_t *secret) {
+  
+  const __m128i prime32 = _mm_set1_epi32((int) XXH_PRIME32_1);
+  for (int i = 0; i < 4; i++) {
+    const __m128i acc_vec = _mm_loadu_si128((const __m128i *) (acc + 2 * i));
+    const __m128i data_vec = _mm_xor_si128(acc_vec, _mm_srli_epi64(acc_vec, 47));
+    const __m128i key_vec = _mm_loadu_si128((const __m128i *) (secret + 16 * i));
+    const __m128i data_key = _mm_xor_si128(data_vec, key_vec);
+    const __m128i data_key_hi = _mm_shuffle_epi32(data_key, _MM_SHUFFLE(0, 3, 0, 1));
+    const __m128i prod_lo = _mm_mul_epu32(data_key, prime32);
+    const __m128i prod_hi = _mm_mul_epu32(data_key_hi, prime32);
+    _mm_storeu_si128((__m128i *) (acc + 2 * i), _mm_add_epi64(prod_lo, _mm_slli_epi64(prod_hi, 32)));
+  }
+  
+}
+
+#endif
+
+#ifdef SB_X86_AVX2
+
+__attribute__((target("avx2")))
+static void XXH3_accumulate_avx2(uint64_t acc[8], const uint8_t *input,
+                                 const uint8_t *secret, size_t nbStripes) {
+  
+  __m256i a[2];
+  for (int i = 0; i < 2; i++)
+    a[i] = _mm256_loadu_si256((const __m256i *) (acc + 4 * i));
+  
+  for (size_t n = 0; n < nbStripes; n++) {
+    const uint8_t *in = input + n * XXH_STRIPE_LEN;
+    const uint8_t *sec = secret + n * XXH_SECRET_CONSUME_RATE;
+    for (int i = 0; i < 2; i++) {
+      const __m256i data_vec = _mm256_loadu_si256((const __m256i *) (in + 32 * i));
+      const __m256i key_vec = _mm256_loadu_si256((const __m256i *) (sec + 32 * i));
+      const __m256i data_key = _mm256_xor_si256(data_vec, key_vec);
+      const __m256i data_key_lo = _mm256_srli_epi64(data_key, 32);
+      const __m256i product = _mm256_mul_epu32(data_key, data_key_lo);
+      const __m256i data_swap = _mm256_shuffle_epi32(data_vec, _MM_SHUFFLE(1, 0, 3, 2));
+      a[i] = _mm256_add_epi64(product, _mm256_add_epi64(a[i], data_swap));
+    }
+  }
+  
+  for (int i = 0; i < 2; i++)
+    _mm256_storeu_si256((__m256i *) (acc + 4 * i), a[i]);
+  
+}
+
+__attribute__((target("avx2")))
+static void XXH3_scramble_avx2(uint64_t acc[8], const uint8_t *secret) {
+  
+  const __m256i prime32 = _mm256_set1_epi32((int) XXH_PRIME32_1);
+  for (int i = 0; i < 2; i++) {
+    const __m256i acc_vec = _mm256_loadu_si256((const __m256i *) (acc + 4 * i));
+    const __m256i data_vec = _mm256_xor_si256(acc_vec, _mm256_srli_epi64(acc_vec, 47));
+    const __m256i key_vec = _mm256_loadu_si256((const __m256i *) (secret + 32 * i));
+    const __m256i data_key = _mm256_xor_si256(data_vec, key_vec);
+    const __m256i data_key_hi = _mm256_srli_epi64(data_key, 32);
+    const __m256i prod_lo = _mm256_mul_epu32(data_key, prime32);
+    const __m256i prod_hi = _mm256_mul_epu32(data_key_hi, prime32);
+    _mm256_storeu_si256((__m256i *) (acc + 4 * i), _mm256_add_epi64(prod_lo, _mm256_slli_epi64(prod_hi, 32)));
+  }
+  
+}
+
+__attribute__((target("avx512f")))
+static void XXH3_accumulate_avx512(uint64_t acc[8], const uint8_t *input,
+                                   const uint8_t *secret, size_t nbStripes) {
+  
+  __m512i a = _mm512_loadu_si512((const void *) acc);
+  
+  for (size_t n = 0; n < nbStripes; n++) {
+    const __m512i data_vec = _mm512_loadu_si512((const void *) (input + n * XXH_STRIPE_LEN));
+    const __m512i key_vec = _mm512_loadu_si512((const void *) (secret + n * XXH_SECRET_CONSUME_RATE));
+    const __m512i data_key = _mm512_xor_si512(data_vec, key_vec);
+    const __m512i data_key_lo = _mm512_srli_epi64(data_key, 32);
+    const __m512i product = _mm512_mul_epu32(data_key, data_key_lo);
+    const __m512i data_swap = _mm512_shuffle_epi32(data_vec, (_MM_PERM_ENUM) _MM_SHUFFLE(1, 0, 3, 2));
+    a = _mm512_add_epi64(product, _mm512_add_epi64(a, data_swap));
+  }
+  
+  _mm512_storeu_si512((void *) acc, a);
+  
+}
+
+__attribute__((target("avx512f")))
+static void XXH3_scramble_avx512(uint64_t acc[8], const uint8_t *secret) {
+  
+  const __m512i prime32 = _mm512_set1_epi32((int) XXH_PRIME32_1);
+  const __m512i acc_vec = _mm512_loadu_si512((const void *) acc);
+  const __m512i key_vec = _mm512_loadu_si512((const void *) secret);
+  const __m512i data_key = _mm512_ternarylogic_epi32(key_vec, acc_vec, _mm512_srli_epi64(acc_vec, 47), 0x96);
+  const __m512i data_key_hi = _mm512_srli_epi64(data_key, 32);
+  const __m512i prod_lo = _mm512_mul_epu32(data_key, prime32);
+  const __m512i prod_hi = _mm512_mul_epu32(data_key_hi, prime32);
+  _mm512_storeu_si512((void *) acc, _mm512_add_epi64(prod_lo, _mm512_slli_epi64(prod_hi, 32)));
+  
+}
+
+#endif
+
+static void (*XXH3_accumulate)(uint64_t *, const uint8_t *, const uint8_t *,
+                               size_t) = XXH3_accumulate_scalar;
+static void (*XXH3_scramble)(uint64_t *, const uint8_t *) = XXH3_scramble_scalar;
+
+const char * sb_xxh3_select(const int cpu) {
+  
+#ifdef SB_X86_AVX2
+  if (cpu & SB_CPU_AVX512) {
+    XXH3_accumulate = XXH3_accumulate_avx512;
+    XXH3_scramble = XXH3_scramble_avx512;
+    return "avx512";
+  }
+  if (cpu & SB_CPU_AVX2) {
+    XXH3_accumulate = XXH3_accumulate_avx2;
+    XXH3_scramble = XXH3_scramble_avx2;
+    return "avx2";
+  }
+#endif
+#ifdef SB_X86_SIMD
+  if (cpu & SB_CPU_SSSE3) {
+    XXH3_accumulate = XXH3_accumulate_sse2;
+    XXH3_scramble = XXH3_scramble_sse2;
+    return "sse2";
+  }
+#endif
+  XXH3_accumulate = XXH3_accumulate_scalar;
+  XXH3_scramble = XXH3_scramble_scalar;
+  return "portable";
+  
+}
+
+// secretbase - xxh3 streaming -------------------------------------------------
+
+/*
+ *  A stripe is only consumed once input is known to follow it, as the final
+ *  stripe is always the last 64 bytes of input, processed with a different
+ *  secret offset. The 64 bytes preceding the pending data are kept, so that
+ *  a final stripe overlapping consumed input is contiguous in the buffer.
+ */
+
+static void XXH3_reset(XXH3_state *state, uint64_t seed) {
+  
+  static const uint64_t acc_init[8] = {
+    XXH_PRIME32_3, XXH_PRIME64_1, XXH_PRIME64_2, XXH_PRIME64_3,
+    XXH_PRIME64_4, XXH_PRIME32_2, XXH_PRIME64_5, XXH_PRIME32_1
+  };
+  memcpy(state->acc, acc_init, sizeof(acc_init));
+  for (size_t i = 0; i < XXH3_SECRET_SIZE / 16; i++) {
+    XXH_write64(state->secret + 16 * i, XXH_read64(XXH3_kSecret + 16 * i) + seed);
+    XXH_write64(state->secret + 16 * i + 8, XXH_read64(XXH3_kSecret + 16 * i + 8) - seed);
+  }
+  state->buffered = 0;
+  state->stripes = 0;
+  state->total = 0;
+  state->seed = seed;
+  
+}
+
+static void XXH3_consume_stripes(uint64_t acc[8], size_t *stripes, const uint8_t *secret,
+                                 const uint8_t *input, size_t nbStripes) {
+  
+  while (nbStripes) {
+    size_t n = XXH_STRIPES_PER_BLOCK - *stripes;
+    if (n > nbStripes)
+      n = nbStripes;
+    XXH3_accumulate(acc, input, secret + *stripes * XXH_SECRET_CONSUME_RATE, n);
+    input += n * XXH_STRIPE_LEN;
+    nbStripes -= n;
+    *stripes += n;
+    if (*stripes == XXH_STRIPES_PER_BLOCK) {
+      XXH3_scramble(acc, secret + XXH3_SECRET_SIZE - XXH_STRIPE_LEN);
+      *stripes = 0;
+    }
+  }
+  
+}
+
+static void XXH3_update(XXH3_state *state, const uint8_t *input, size_t len) {
+  
+  uint8_t *pending = state->buffer + XXH_STRIPE_LEN;
+  state->total += len;
+  
+  if (len <= XXH3_INTERNALBUFFER_SIZE - state->buffered) {
+    memcpy(pending + state->buffered, input, len);
+    state->buffered += len;
+    return;
+  }
+  
+  if (state->buffered) {
+    const size_t fill = XXH3_INTERNALBUFFER_SIZE - state->buffered;
+    memcpy(pending + state->buffered, input, fill);
+    input += fill;
+    len -= fill;
+    XXH3_consume_stripes(state->acc, &state->stripes, state->secret, pending,
+                         XXH3_INTERNALBUFFER_SIZE / XXH_STRIPE_LEN);
+    memcpy(state->buffer, pending + XXH3_INTERNALBUFFER_SIZE - XXH_STRIPE_LEN, XXH_STRIPE_LEN);
+    state->buffered = 0;
+  }
+  
+  if (len > XXH3_INTERNALBUFFER_SIZE) {
+    const size_t nbStripes = (len - 1) / XXH_STRIPE_LEN;
+    XXH3_consume_stripes(state->acc, &state->stripes, state->secret, input, nbStripes);
+    input += nbStripes * XXH_STRIPE_LEN;
+    len -= nbStripes * XXH_STRIPE_LEN;
+    memcpy(state->buffer, input - XXH_STRIPE_LEN, XXH_STRIPE_LEN);
+  }
+  
+  memcpy(pending, input, len);
+  state->buffered = len;
+  
+}
+
+static inline uint64_t XXH3_mergeAccs(const uint64_t acc[8], const uint8_t *secret,
+                                      uint64_t start) {
+  
+  uint64_t result64 = start;
+  for (size_t i = 0; i < 4; i++)
+    result64 += XXH3_mul128_fold64(acc[2 * i] ^ XXH_read64(secret + 16 * i),
+                                   acc[2 * i + 1] ^ XXH_read64(secret + 16 * i + 8));
+  return XXH3_avalanche(result64);
+  
+}
+
+static void XXH3_digest_long(const XXH3_state *state, uint64_t acc[8]) {
+  
+  const uint8_t *pending = state->buffer + XXH_STRIPE_LEN;
+  size_t stripes = state->stripes;
+  memcpy(acc, state->acc, sizeof(state->acc));
+  XXH3_consume_stripes(acc, &stripes, state->secret, pending,
+                       (state->buffered - 1) / XXH_STRIPE_LEN);
+  XXH3_accumulate(acc, pending + state->buffered - XXH_STRIPE_LEN,
+                  state->secret + XXH3_SECRET_SIZE - XXH_STRIPE_LEN - XXH_SECRET_LASTACC_START, 1);
+  
+}
+
+static void XXH3_digest(const XXH3_state *state, unsigned char *out, const int bits) {
+  
+  const uint8_t *input = state->buffer + XXH_STRIPE_LEN;
+  const size_t len = (size_t) state->total;
+  const uint64_t seed = state->seed;
+  XXH128_hash h;
+  
+  if (state->total > XXH3_MIDSIZE_MAX) {
+    uint64_t acc[8];
+    XXH3_digest_long(state, acc);
+    h.low64 = XXH3_mergeAccs(acc, state->secret + XXH_SECRET_MERGEACCS_START,
+                             state->total * XXH_PRIME64_1);
+    h.high64 = bits == 128 ?
+      XXH3_mergeAccs(acc, state->secret + XXH3_SECRET_SIZE - XXH_STRIPE_LEN - XXH_SECRET_MERGEACCS_START,
+                     ~(state->total * XXH_PRIME64_2)) : 0;
+  } else if (bits == 128) {
+    h = len <= 16 ? XXH3_len_0to16_128b(input, len, XXH3_kSecret, seed) :
+      len <= 128 ? XXH3_len_17to128_128b(input, len, XXH3_kSecret, seed) :
+      XXH3_len_129to240_128b(input, len, XXH3_kSecret, seed);
+  } else {
+    h.low64 = len <= 16 ? XXH3_len_0to16_64b(input, len, XXH3_kSecret, seed) :
+      len <= 128 ? XXH3_len_17to128_64b(input, len, XXH3_kSecret, seed) :
+      XXH3_len_129to240_64b(input, len, XXH3_kSecret, seed);
+  }
+  
+  /* canonical representation: big-endian, high half first */
+  if (bits == 128) {
+    MBEDTLS_PUT_UINT64_BE(h.high64, out, 0);
+    MBEDTLS_PUT_UINT64_BE(h.low64, out, 8);
+  } else {
+    MBEDTLS_PUT_UINT64_BE(h.low64, out, 0);
+  }
+  
+}
+
+// secretbase - internals ------------------------------------------------------
+
+static void hash_bytes(void *ctx, const unsigned char *buf, size_t len) {
+  
+  XXH3_update((XXH3_state *) ctx, buf, len);
+  
+}
+
+static void hash_file(XXH3_state *ctx, const SEXP x) {
+  
+  SB_ASSERT_STR(x);
+  const char *file = R_ExpandFileName(CHAR(*STRING_PTR_RO(x)));
+  unsigned char buf[SB_BUF_SIZE];
+  FILE *f;
+  size_t cur;
+  
+  if ((f = fopen(file, "rb")) == NULL)
+    ERROR_FOPEN(file);
+  
+  setbuf(f, NULL);
+  
+  while ((cur = fread(buf, sizeof(char), SB_BUF_SIZE, f))) {
+    XXH3_update(ctx, buf, cur);
+  }
+  
+  if (ferror(f)) {
+    fclose(f);
+    ERROR_FREAD(file);
+  }
+  fclose(f);
+  
+}
+
+static void hash_object(XXH3_state *ctx, const SEXP x) {
+  
+  switch (TYPEOF(x)) {
+  case STRSXP:
+    if (XLENGTH(x) == 1 && NO_ATTRIB(x)) {
+      const char *s = CHAR(*STRING_PTR_RO(x));
+      XXH3_update(ctx, (uint8_t *) s, strlen(s));
+      return;
+    }
+    break;
+  case RAWSXP:
+    if (NO_ATTRIB(x)) {
+      sb_hash_raw(x, ctx, hash_bytes);
+      return;
+    }
+    break;
+  }
+  
+  sb_hash_serial(x, ctx, hash_bytes);
+  
+}
+
+static uint64_t sb_xxh3_seed(const SEXP seed) {
+  
+  switch (TYPEOF(seed)) {
+  case NILSXP:
+    return 0;
+  case RAWSXP:
+    if (XLENGTH(seed) == 8)
+      return MBEDTLS_GET_UINT64_LE((const unsigned char *) DATAPTR_RO(seed), 0);
+    break;
+  case INTSXP:
+  case REALSXP:
+    if (XLENGTH(seed) == 1) {
+      const double s = Rf_asReal(seed);
+      if (s >= 0 && s <= 9007199254740992.0 && s == (double) (uint64_t) s)
+        return (uint64_t) s;
+    }
+    break;
+  }
+  Rf_error("'seed' must be a whole number between 0 and 2^53, an 8-byte raw vector or NULL");
+  
+}
+
+static SEXP secretbase_xxh3_impl(const SEXP x, const SEXP bits, const SEXP seed,
+                                 const SEXP convert,
+                                 void (*const hash_func)(XXH3_state *, SEXP)) {
+  
+  SB_ASSERT_LOGICAL(convert);
+  const int conv = SB_LOGICAL(convert);
+  const int bt = sb_integer(bits);
+  if (bt != 64 && bt != 128)
+    Rf_error("'bits' must be 64 or 128");
+  unsigned char buf[16];
+  
+  XXH3_state ctx;
+  XXH3_reset(&ctx, sb_xxh3_seed(seed));
+  hash_func(&ctx, x);
+  XXH3_digest(&ctx, buf, bt);
+  
+  return sb_hash_sexp(buf, (size_t) (bt / 8), conv);
+  
+}
+
+// secretbase - exported functions ---------------------------------------------
+
+SEXP secretbase_xxh3(SEXP x, SEXP bits, SEXP seed, SEXP convert) {
+  
+  return secretbase_xxh3_impl(x, bits, seed, convert, hash_object);
+  
+}
+
+SEXP secretbase_xxh3_file(SEXP x, SEXP bits, SEXP seed, SEXP convert) {
+  
+  return secretbase_xxh3_impl(x, bits, seed, convert, hash_file);
+  
+}